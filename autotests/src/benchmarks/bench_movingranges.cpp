@@ -0,0 +1,188 @@
+/*
+    SPDX-FileCopyrightText: 2026 KTextEditor contributors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "bench_movingranges.h"
+
+#include <katebuffer.h>
+#include <katedocument.h>
+#include <katetextrange.h>
+
+#include <QRandomGenerator>
+#include <QStandardPaths>
+#include <QStringList>
+#include <QTest>
+
+#include <memory>
+
+QTEST_MAIN(MovingRangesBenchmark)
+
+using namespace KTextEditor;
+
+MovingRangesBenchmark::MovingRangesBenchmark()
+    : QObject()
+{
+    QStandardPaths::setTestModeEnabled(true);
+}
+
+static void fillDocument(KTextEditor::DocumentPrivate &doc, int lines)
+{
+    QStringList text;
+    text.reserve(lines);
+    for (int i = 0; i < lines; ++i) {
+        text.append(QStringLiteral("This is line number %1 of the benchmark text").arg(i));
+    }
+    doc.setText(text);
+}
+
+void MovingRangesBenchmark::benchmarkCursorFixup_data()
+{
+    QTest::addColumn<int>("cursors");
+    QTest::addColumn<int>("lines");
+
+    QTest::newRow("10k cursors, 10k lines") << 10000 << 10000;
+    QTest::newRow("100k cursors, 10k lines") << 100000 << 10000;
+    QTest::newRow("100k cursors, 100k lines") << 100000 << 100000;
+}
+
+void MovingRangesBenchmark::benchmarkCursorFixup()
+{
+    QFETCH(int, cursors);
+    QFETCH(int, lines);
+
+    KTextEditor::DocumentPrivate doc;
+    fillDocument(doc, lines);
+    Kate::TextBuffer &buffer = doc.buffer();
+
+    std::vector<std::unique_ptr<MovingCursor>> movingCursors;
+    movingCursors.reserve(cursors);
+    QRandomGenerator random(4711);
+    for (int i = 0; i < cursors; ++i) {
+        const int line = random.bounded(lines);
+        const auto behavior = (i % 2) ? MovingCursor::MoveOnInsert : MovingCursor::StayOnInsert;
+        movingCursors.emplace_back(doc.newMovingCursor(Cursor(line, random.bounded(buffer.lineLength(line) + 1)), behavior));
+    }
+
+    // typing, line splitting and joining at random positions, every edit needs to fix up the cursors of the touched blocks
+    std::vector<Cursor> positions(10000);
+    for (auto &position : positions) {
+        const int line = random.bounded(lines);
+        position = Cursor(line, random.bounded(buffer.lineLength(line) + 1));
+    }
+
+    QBENCHMARK {
+        buffer.startEditing();
+        for (const auto position : positions) {
+            buffer.insertText(position, QStringLiteral("xx"));
+            buffer.wrapLine(Cursor(position.line(), position.column() + 1));
+            buffer.unwrapLine(position.line() + 1);
+            buffer.removeText(Range(position, Cursor(position.line(), position.column() + 2)));
+        }
+        buffer.finishEditing();
+    }
+    QCOMPARE(buffer.lines(), lines);
+}
+
+void MovingRangesBenchmark::benchmarkRangesForLine_data()
+{
+    QTest::addColumn<int>("rangesPerLine");
+    QTest::addColumn<int>("multiLineRanges");
+
+    QTest::newRow("1 range per line") << 1 << 0;
+    QTest::newRow("10 ranges per line") << 10 << 0;
+    QTest::newRow("10 ranges per line, 10k multi-line") << 10 << 10000;
+}
+
+void MovingRangesBenchmark::benchmarkRangesForLine()
+{
+    QFETCH(int, rangesPerLine);
+    QFETCH(int, multiLineRanges);
+
+    const int lines = 100000;
+    KTextEditor::DocumentPrivate doc;
+    fillDocument(doc, lines);
+    Kate::TextBuffer &buffer = doc.buffer();
+
+    // dense ranges like search or spell check highlights
+    std::vector<std::unique_ptr<MovingRange>> ranges;
+    ranges.reserve(qsizetype(lines) * rangesPerLine + multiLineRanges);
+    for (int line = 0; line < lines; ++line) {
+        for (int i = 0; i < rangesPerLine; ++i) {
+            ranges.emplace_back(doc.newMovingRange(Range(line, i * 4, line, i * 4 + 3)));
+        }
+    }
+    QRandomGenerator random(4711);
+    for (int i = 0; i < multiLineRanges; ++i) {
+        const int start = random.bounded(lines);
+        const int end = std::min(lines - 1, start + 1 + random.bounded(100));
+        ranges.emplace_back(doc.newMovingRange(Range(start, 0, end, 0)));
+    }
+
+    std::vector<int> accessedLines(10000);
+    for (auto &line : accessedLines) {
+        line = random.bounded(lines);
+    }
+
+    QList<Kate::TextRange *> rangesOnLine;
+    qsizetype sum = 0;
+    QBENCHMARK {
+        for (const int line : accessedLines) {
+            buffer.rangesForLine(line, nullptr, false, rangesOnLine);
+            sum += rangesOnLine.size();
+        }
+    }
+    QVERIFY(sum >= qsizetype(accessedLines.size()) * rangesPerLine);
+}
+
+void MovingRangesBenchmark::benchmarkTransformCursors_data()
+{
+    QTest::addColumn<bool>("batch");
+
+    QTest::newRow("per cursor") << false;
+    QTest::newRow("batch") << true;
+}
+
+void MovingRangesBenchmark::benchmarkTransformCursors()
+{
+    QFETCH(bool, batch);
+
+    const int lines = 10000;
+    KTextEditor::DocumentPrivate doc;
+    fillDocument(doc, lines);
+    KTextEditor::Document &document = doc;
+
+    const qint64 rev = doc.revision();
+    doc.lockRevision(rev);
+
+    // typing in some lines of the document
+    for (int i = 0; i < 2000; ++i) {
+        const int line = (i * 37) % lines;
+        doc.insertText({line, 4}, QStringLiteral("x"));
+        if (i % 10 == 0) {
+            doc.editWrapLine(line, 10);
+        }
+    }
+
+    // positions of diagnostics, one per line
+    std::vector<Cursor> cursors;
+    for (int line = 0; line < lines; ++line) {
+        cursors.emplace_back(line, 5);
+    }
+
+    QBENCHMARK {
+        std::vector<Cursor> transformed = cursors;
+        if (batch) {
+            document.transformCursors(transformed, MovingCursor::MoveOnInsert, rev);
+        } else {
+            for (auto &cursor : transformed) {
+                document.transformCursor(cursor, MovingCursor::MoveOnInsert, rev);
+            }
+        }
+    }
+
+    doc.unlockRevision(rev);
+}
+
+#include "moc_bench_movingranges.cpp"
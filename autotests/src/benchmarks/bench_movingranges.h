@@ -0,0 +1,28 @@
+/*
+    SPDX-FileCopyrightText: 2026 KTextEditor contributors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef KTEXTEDITOR_BENCH_MOVINGRANGES_H
+#define KTEXTEDITOR_BENCH_MOVINGRANGES_H
+
+#include <QObject>
+
+class MovingRangesBenchmark : public QObject
+{
+    Q_OBJECT
+
+public:
+    MovingRangesBenchmark();
+
+private Q_SLOTS:
+    void benchmarkCursorFixup_data();
+    void benchmarkCursorFixup();
+    void benchmarkRangesForLine_data();
+    void benchmarkRangesForLine();
+    void benchmarkTransformCursors_data();
+    void benchmarkTransformCursors();
+};
+
+#endif // KTEXTEDITOR_BENCH_MOVINGRANGES_H
@@ -0,0 +1,179 @@
+/*
+    SPDX-FileCopyrightText: 2026 KTextEditor contributors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "bench_textbuffer_edit.h"
+
+#include <katebuffer.h>
+#include <katedocument.h>
+#include <katetextline.h>
+
+#include <QRandomGenerator>
+#include <QStandardPaths>
+#include <QStringList>
+#include <QTest>
+
+QTEST_MAIN(TextBufferEditBenchmark)
+
+TextBufferEditBenchmark::TextBufferEditBenchmark()
+    : QObject()
+{
+    QStandardPaths::setTestModeEnabled(true);
+}
+
+static void fillDocument(KTextEditor::DocumentPrivate &doc, int lines)
+{
+    QStringList text;
+    text.reserve(lines);
+    for (int i = 0; i < lines; ++i) {
+        text.append(QStringLiteral("This is line number %1 of the benchmark text").arg(i));
+    }
+    doc.setText(text);
+}
+
+static void addSizeRows()
+{
+    QTest::addColumn<int>("lines");
+
+    QTest::newRow("10k lines") << 10000;
+    QTest::newRow("100k lines") << 100000;
+    QTest::newRow("1M lines") << 1000000;
+}
+
+void TextBufferEditBenchmark::benchmarkRandomLine_data()
+{
+    addSizeRows();
+}
+
+void TextBufferEditBenchmark::benchmarkRandomLine()
+{
+    QFETCH(int, lines);
+
+    KTextEditor::DocumentPrivate doc;
+    fillDocument(doc, lines);
+    const Kate::TextBuffer &buffer = doc.buffer();
+
+    // same access pattern for each run
+    std::vector<int> accessedLines(100000);
+    QRandomGenerator random(4711);
+    for (auto &line : accessedLines) {
+        line = random.bounded(buffer.lines());
+    }
+
+    qsizetype sum = 0;
+    QBENCHMARK {
+        for (int line : accessedLines) {
+            sum += buffer.line(line).text().size();
+        }
+    }
+    QVERIFY(sum > 0);
+}
+
+void TextBufferEditBenchmark::benchmarkBulkInsertRemove_data()
+{
+    addSizeRows();
+}
+
+void TextBufferEditBenchmark::benchmarkBulkInsertRemove()
+{
+    QFETCH(int, lines);
+
+    KTextEditor::DocumentPrivate doc;
+    fillDocument(doc, lines);
+    Kate::TextBuffer &buffer = doc.buffer();
+
+    // insert a block of lines in the middle and remove it again, the buffer is unchanged after each run
+    QStringList block;
+    for (int i = 0; i < lines / 10; ++i) {
+        block.append(QStringLiteral("inserted line %1").arg(i));
+    }
+    const int line = lines / 2;
+
+    QBENCHMARK {
+        buffer.startEditing();
+        for (auto it = block.crbegin(); it != block.crend(); ++it) {
+            buffer.wrapLine(KTextEditor::Cursor(line, 0));
+            buffer.insertText(KTextEditor::Cursor(line, 0), *it);
+        }
+        buffer.finishEditing();
+
+        buffer.startEditing();
+        for (const QString &text : std::as_const(block)) {
+            buffer.removeText(KTextEditor::Range(line, 0, line, text.size()));
+            buffer.unwrapLine(line + 1);
+        }
+        buffer.finishEditing();
+    }
+    QCOMPARE(buffer.lines(), lines);
+}
+
+void TextBufferEditBenchmark::benchmarkWrapUnwrap_data()
+{
+    addSizeRows();
+}
+
+void TextBufferEditBenchmark::benchmarkWrapUnwrap()
+{
+    QFETCH(int, lines);
+
+    KTextEditor::DocumentPrivate doc;
+    fillDocument(doc, lines);
+    Kate::TextBuffer &buffer = doc.buffer();
+
+    // wrap at random positions and join the lines again, blocks get split and merged all over the buffer
+    std::vector<KTextEditor::Cursor> positions(100000);
+    QRandomGenerator random(4711);
+    for (auto &position : positions) {
+        const int line = random.bounded(lines);
+        position = KTextEditor::Cursor(line, random.bounded(buffer.lineLength(line) + 1));
+    }
+
+    QBENCHMARK {
+        buffer.startEditing();
+        for (const auto position : positions) {
+            buffer.wrapLine(position);
+            buffer.unwrapLine(position.line() + 1);
+        }
+        buffer.finishEditing();
+    }
+    QCOMPARE(buffer.lines(), lines);
+}
+
+void TextBufferEditBenchmark::benchmarkUndoRedo_data()
+{
+    QTest::addColumn<int>("edits");
+
+    QTest::newRow("1k edits") << 1000;
+    QTest::newRow("10k edits") << 10000;
+    QTest::newRow("100k edits") << 100000;
+}
+
+void TextBufferEditBenchmark::benchmarkUndoRedo()
+{
+    QFETCH(int, edits);
+
+    KTextEditor::DocumentPrivate doc;
+    fillDocument(doc, 100000);
+
+    // one undo group containing all edits, like a replace all
+    doc.editStart();
+    for (int i = 0; i < edits; ++i) {
+        const int line = i % doc.lines();
+        doc.insertText(KTextEditor::Cursor(line, 0), QStringLiteral("x"));
+        if (i % 10 == 0) {
+            doc.editWrapLine(line, 1);
+        }
+    }
+    doc.editEnd();
+    const QString text = doc.text();
+
+    QBENCHMARK {
+        doc.undo();
+        doc.redo();
+    }
+    QCOMPARE(doc.text(), text);
+}
+
+#include "moc_bench_textbuffer_edit.cpp"
@@ -0,0 +1,30 @@
+/*
+    SPDX-FileCopyrightText: 2026 KTextEditor contributors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef KTEXTEDITOR_BENCH_TEXTBUFFER_EDIT_H
+#define KTEXTEDITOR_BENCH_TEXTBUFFER_EDIT_H
+
+#include <QObject>
+
+class TextBufferEditBenchmark : public QObject
+{
+    Q_OBJECT
+
+public:
+    TextBufferEditBenchmark();
+
+private Q_SLOTS:
+    void benchmarkRandomLine_data();
+    void benchmarkRandomLine();
+    void benchmarkBulkInsertRemove_data();
+    void benchmarkBulkInsertRemove();
+    void benchmarkWrapUnwrap_data();
+    void benchmarkWrapUnwrap();
+    void benchmarkUndoRedo_data();
+    void benchmarkUndoRedo();
+};
+
+#endif // KTEXTEDITOR_BENCH_TEXTBUFFER_EDIT_H
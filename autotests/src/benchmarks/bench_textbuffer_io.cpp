@@ -0,0 +1,133 @@
+/*
+    SPDX-FileCopyrightText: 2026 KTextEditor contributors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "bench_textbuffer_io.h"
+
+#include <katedocument.h>
+#include <katetextbuffer.h>
+
+#include <QFile>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <QStringEncoder>
+#include <QTest>
+
+QTEST_MAIN(TextBufferIoBenchmark)
+
+/**
+ * Size of the generated files in MiB, can be lowered for quick runs
+ * via the KTEXTEDITOR_BENCHMARK_FILE_SIZE environment variable.
+ */
+static qsizetype benchmarkFileSize()
+{
+    bool ok = false;
+    const int size = qEnvironmentVariableIntValue("KTEXTEDITOR_BENCHMARK_FILE_SIZE", &ok);
+    return qsizetype(ok && size > 0 ? size : 100) * 1024 * 1024;
+}
+
+TextBufferIoBenchmark::TextBufferIoBenchmark()
+    : QObject()
+{
+    QStandardPaths::setTestModeEnabled(true);
+}
+
+void TextBufferIoBenchmark::initTestCase()
+{
+    QVERIFY(m_dir.isValid());
+}
+
+/**
+ * Get the benchmark file in the given encoding, it is generated on first use.
+ * The text mixes ASCII with some Latin-1 characters, so that all encodings have to do real work.
+ */
+QString TextBufferIoBenchmark::fileForCodec(const QString &codec)
+{
+    const QString fileName = m_dir.filePath(codec);
+    if (QFile::exists(fileName)) {
+        return fileName;
+    }
+
+    const qsizetype size = benchmarkFileSize();
+    QString text;
+    text.reserve(size + 128);
+    for (int i = 0; text.size() < size; ++i) {
+        text += QStringLiteral("%1: the quick brown fox jumps over the lazy dog, äöü ß é\n").arg(i);
+    }
+
+    QStringEncoder encoder(codec.toUtf8().constData());
+    const QByteArray data = encoder.encode(text);
+    if (encoder.hasError()) {
+        return QString();
+    }
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size()) {
+        return QString();
+    }
+    return fileName;
+}
+
+void TextBufferIoBenchmark::benchmarkLoad_data()
+{
+    QTest::addColumn<QString>("codec");
+
+    QTest::newRow("UTF-8") << QStringLiteral("UTF-8");
+    QTest::newRow("ISO-8859-1") << QStringLiteral("ISO-8859-1");
+    QTest::newRow("UTF-16LE") << QStringLiteral("UTF-16LE");
+}
+
+void TextBufferIoBenchmark::benchmarkLoad()
+{
+    QFETCH(QString, codec);
+
+    const QString fileName = fileForCodec(codec);
+    QVERIFY(!fileName.isEmpty());
+
+    KTextEditor::DocumentPrivate doc;
+    Kate::TextBuffer buffer(&doc);
+    buffer.setTextCodec(codec);
+    buffer.setFallbackTextCodec(QStringLiteral("ISO-8859-1"));
+
+    bool encodingErrors = false;
+    bool tooLongLinesWrapped = false;
+    int longestLineLoaded = 0;
+    QBENCHMARK {
+        QVERIFY(buffer.load(fileName, encodingErrors, tooLongLinesWrapped, longestLineLoaded, true));
+    }
+    QVERIFY(!encodingErrors);
+    QVERIFY(buffer.lines() > 1);
+}
+
+void TextBufferIoBenchmark::benchmarkSave_data()
+{
+    benchmarkLoad_data();
+}
+
+void TextBufferIoBenchmark::benchmarkSave()
+{
+    QFETCH(QString, codec);
+
+    const QString fileName = fileForCodec(codec);
+    QVERIFY(!fileName.isEmpty());
+
+    KTextEditor::DocumentPrivate doc;
+    Kate::TextBuffer buffer(&doc);
+    buffer.setTextCodec(codec);
+    buffer.setFallbackTextCodec(QStringLiteral("ISO-8859-1"));
+
+    bool encodingErrors = false;
+    bool tooLongLinesWrapped = false;
+    int longestLineLoaded = 0;
+    QVERIFY(buffer.load(fileName, encodingErrors, tooLongLinesWrapped, longestLineLoaded, true));
+
+    const QString saveFileName = m_dir.filePath(codec + QLatin1String(".saved"));
+    QBENCHMARK {
+        QVERIFY(buffer.save(saveFileName));
+    }
+    QCOMPARE(QFileInfo(saveFileName).size(), QFileInfo(fileName).size());
+}
+
+#include "moc_bench_textbuffer_io.cpp"
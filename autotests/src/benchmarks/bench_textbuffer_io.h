@@ -0,0 +1,34 @@
+/*
+    SPDX-FileCopyrightText: 2026 KTextEditor contributors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef KTEXTEDITOR_BENCH_TEXTBUFFER_IO_H
+#define KTEXTEDITOR_BENCH_TEXTBUFFER_IO_H
+
+#include <QObject>
+#include <QTemporaryDir>
+
+class TextBufferIoBenchmark : public QObject
+{
+    Q_OBJECT
+
+public:
+    TextBufferIoBenchmark();
+
+private Q_SLOTS:
+    void initTestCase();
+
+    void benchmarkLoad_data();
+    void benchmarkLoad();
+    void benchmarkSave_data();
+    void benchmarkSave();
+
+private:
+    QString fileForCodec(const QString &codec);
+
+    QTemporaryDir m_dir;
+};
+
+#endif // KTEXTEDITOR_BENCH_TEXTBUFFER_IO_H
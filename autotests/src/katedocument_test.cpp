@@ -8,6 +8,7 @@
 #include "katedocument_test.h"
 #include "moc_katedocument_test.cpp"
 
+#include <katebuffer.h>
 #include <kateconfig.h>
 #include <katedocument.h>
 #include <kateglobal.h>
@@ -16,6 +17,7 @@
 #include <KLazyLocalizedString>
 #include <KLocalizedString>
 
+#include <QDir>
 #include <QRegularExpression>
 #include <QSignalSpy>
 #include <QStandardPaths>
@@ -1129,3 +1131,249 @@ void KateDocumentTest::testDocumentDeduplication()
     fileDoc2.setUrl(QUrl(QStringLiteral("file:///elsewhere/test.txt")));
     QCOMPARE(fileDoc2.documentName(), QStringLiteral("test.txt - elsewhere"));
 }
+
+void KateDocumentTest::testHighlightingInPlace()
+{
+    KTextEditor::DocumentPrivate doc;
+    doc.setHighlightingMode(QStringLiteral("C++"));
+    doc.setText(QStringLiteral("int a = 1;\n/* open\ncomment */ int b;\nint c;"));
+    doc.buffer().ensureHighlighted(doc.lines() - 1);
+
+    // the highlighting state is carried over from line to line
+    QCOMPARE(doc.defStyleNum(1, 0), KSyntaxHighlighting::Theme::TextStyle::Comment);
+    QCOMPARE(doc.defStyleNum(2, 0), KSyntaxHighlighting::Theme::TextStyle::Comment);
+    QVERIFY(doc.defStyleNum(3, 4) != KSyntaxHighlighting::Theme::TextStyle::Comment);
+
+    // the lines are highlighted in place, the attributes are not copied
+    const Kate::TextLine::Attribute *attributes = doc.buffer().plainLine(3).attributesList().constData();
+    QVERIFY(attributes);
+    doc.buffer().invalidateHighlighting();
+    doc.buffer().ensureHighlighted(doc.lines() - 1);
+    QCOMPARE(doc.buffer().plainLine(3).attributesList().constData(), attributes);
+
+    // edits highlight the following lines again, the lines keep their text and flags
+    doc.insertText({1, 7}, QStringLiteral(" */"));
+    doc.buffer().ensureHighlighted(doc.lines() - 1);
+    QVERIFY(doc.buffer().plainLine(1).markedAsModified());
+    QCOMPARE(doc.line(2), QStringLiteral("comment */ int b;"));
+    QVERIFY(doc.defStyleNum(2, 0) != KSyntaxHighlighting::Theme::TextStyle::Comment);
+}
+
+void KateDocumentTest::testBackgroundHighlighting()
+{
+    KTextEditor::DocumentPrivate doc;
+    QStringList text(20000, QStringLiteral("int a = 1;"));
+    text[0] = QStringLiteral("/* open comment");
+    doc.setText(text);
+    doc.setHighlightingMode(QStringLiteral("C++"));
+    KateBuffer &buffer = doc.buffer();
+
+    // far away lines are highlighted in the background, they are painted without highlighting meanwhile
+    const int line = 19000;
+    QVERIFY(!buffer.ensureHighlightedForPainting(line));
+    QVERIFY(buffer.isHighlightingPending(line));
+    QVERIFY(buffer.plainLine(line).attributesList().isEmpty());
+    QTRY_VERIFY(!buffer.isHighlightingPending(line));
+    QVERIFY(!buffer.plainLine(line).attributesList().isEmpty());
+    QCOMPARE(doc.defStyleNum(line, 0), KSyntaxHighlighting::Theme::TextStyle::Comment);
+
+    // results computed for outdated text are dropped
+    buffer.invalidateHighlighting();
+    QVERIFY(!buffer.ensureHighlightedForPainting(line));
+    doc.insertText({0, 15}, QStringLiteral(" */"));
+    QTRY_VERIFY(!buffer.isHighlightingPending(line));
+    QVERIFY(doc.defStyleNum(line, 0) != KSyntaxHighlighting::Theme::TextStyle::Comment);
+
+    // close lines are still highlighted at once
+    buffer.invalidateHighlighting();
+    QVERIFY(buffer.ensureHighlightedForPainting(10));
+    QVERIFY(!buffer.isHighlightingPending(10));
+}
+
+void KateDocumentTest::testHighlightingCheckpoints()
+{
+    {
+        KTextEditor::DocumentPrivate doc;
+        doc.setText(QStringList(10000, QStringLiteral("int a;")));
+        doc.setHighlightingMode(QStringLiteral("C++"));
+        KateBuffer &buffer = doc.buffer();
+        buffer.ensureHighlighted(buffer.lines() - 1);
+
+        // opening and closing a comment doesn't need the following lines to be highlighted again
+        doc.insertText({0, 0}, QStringLiteral("/*"));
+        doc.insertText({0, 2}, QStringLiteral("*/"));
+        buffer.ensureHighlighted(5, 0);
+        QVERIFY(buffer.ensureHighlightedForPainting(9000));
+        QVERIFY(!buffer.isHighlightingPending(9000));
+        QVERIFY(doc.defStyleNum(9000, 0) != KSyntaxHighlighting::Theme::TextStyle::Comment);
+    }
+
+    // the checkpoints are kept if the same text is loaded again
+    QTemporaryFile file(QDir::tempPath() + QStringLiteral("/XXXXXX.cpp"));
+    QVERIFY(file.open());
+    file.write("/* open comment\n" + QByteArray("int a = 1;\n").repeated(20000));
+    file.flush();
+
+    KTextEditor::DocumentPrivate doc;
+    QVERIFY(doc.openUrl(QUrl::fromLocalFile(file.fileName())));
+    doc.setHighlightingMode(QStringLiteral("C++"));
+    KateBuffer &buffer = doc.buffer();
+    buffer.ensureHighlighted(buffer.lines() - 1);
+
+    QVERIFY(doc.documentReload());
+    QVERIFY(!buffer.highlightingCheckpoints().empty());
+    const int line = 15000;
+    QVERIFY(buffer.ensureHighlightedForPainting(line));
+    QVERIFY(!buffer.isHighlightingPending(line));
+    QVERIFY(!buffer.plainLine(line).attributesList().isEmpty());
+    QCOMPARE(doc.defStyleNum(line, 0), KSyntaxHighlighting::Theme::TextStyle::Comment);
+}
+
+void KateDocumentTest::testHighlightingCache()
+{
+    // the name makes the text unique, no cache of an earlier run is found
+    QTemporaryFile file(QDir::tempPath() + QStringLiteral("/XXXXXX.cpp"));
+    QVERIFY(file.open());
+    file.write("/* " + file.fileName().toUtf8() + "\n" + QByteArray("int a = 1;\n").repeated(20000));
+    file.flush();
+    const int line = 15000;
+
+    // the completely highlighted text is cached when the document is closed
+    {
+        KTextEditor::DocumentPrivate doc;
+        doc.config()->setValue(KateDocumentConfig::HighlightingCache, true);
+        QVERIFY(doc.openUrl(QUrl::fromLocalFile(file.fileName())));
+        doc.setHighlightingMode(QStringLiteral("C++"));
+        QVERIFY(!doc.buffer().ensureHighlightedForPainting(line));
+        doc.buffer().ensureHighlighted(doc.lines() - 1);
+    }
+    KateHighlightingCache::waitForWritten();
+
+    // far away lines are highlighted at once when the same text is opened again
+    KTextEditor::DocumentPrivate doc;
+    doc.config()->setValue(KateDocumentConfig::HighlightingCache, true);
+    QVERIFY(doc.openUrl(QUrl::fromLocalFile(file.fileName())));
+    doc.setHighlightingMode(QStringLiteral("C++"));
+    KateBuffer &buffer = doc.buffer();
+    QVERIFY(buffer.ensureHighlightedForPainting(line));
+    QVERIFY(!buffer.isHighlightingPending(line));
+    QVERIFY(!buffer.plainLine(line).attributesList().isEmpty());
+    QCOMPARE(doc.defStyleNum(line, 0), KSyntaxHighlighting::Theme::TextStyle::Comment);
+
+    // attributes outside of the lines or of the highlighting are rejected
+    KateHighlightingCache cache;
+    QVERIFY(cache.open(KateHighlightingCache::fileName(buffer.digest(), buffer.highlight()->definition()), buffer.lines()));
+    const int formats = int(buffer.highlight()->formats().size());
+    std::vector<Kate::TextLine> cachedLines;
+    QVERIFY(cache.readBlock(1, buffer, formats, cachedLines));
+    KTextEditor::DocumentPrivate emptyDoc;
+    emptyDoc.setText(QStringList(buffer.lines(), QString()));
+    QVERIFY(!cache.readBlock(1, emptyDoc.buffer(), formats, cachedLines));
+    QVERIFY(!cache.readBlock(1, buffer, 1, cachedLines));
+
+    // the cached highlighting is not used after an edit
+    doc.insertText({0, 0}, QStringLiteral("int b;\n"));
+    QVERIFY(!buffer.ensureHighlightedForPainting(line + 1000));
+}
+
+void KateDocumentTest::testLongLineHighlighting()
+{
+    KTextEditor::DocumentPrivate doc;
+    QStringList text(20, QStringLiteral("int a = 1;"));
+    const int line = 10;
+    text[line] = QStringLiteral("// ") + QString(KATE_BUFFER_LONG_LINE_LENGTH, QLatin1Char('a'));
+    doc.setText(text);
+    doc.setHighlightingMode(QStringLiteral("C++"));
+    KateBuffer &buffer = doc.buffer();
+
+    // only the first columns of a long line are highlighted at once
+    QVERIFY(buffer.ensureHighlightedForPainting(line));
+    QVERIFY(buffer.isHighlightingPending(line));
+    const auto window = buffer.plainLine(line).attributesList();
+    QVERIFY(!window.isEmpty());
+    QCOMPARE(window.back().offset + window.back().length, KATE_BUFFER_LONG_LINE_WINDOW);
+
+    // the lines after it need its end state
+    QVERIFY(!buffer.ensureHighlightedForPainting(line + 1));
+
+    // the whole line is highlighted in the background
+    QTRY_VERIFY(!buffer.isHighlightingPending(line + 1));
+    const auto attributes = buffer.plainLine(line).attributesList();
+    QCOMPARE(attributes.back().offset + attributes.back().length, buffer.lineLength(line));
+    QVERIFY(buffer.ensureHighlightedForPainting(line + 1));
+}
+
+void KateDocumentTest::testSharedAttributes()
+{
+    KTextEditor::DocumentPrivate doc;
+    QStringList text(1000, QStringLiteral("int a = 1;"));
+    text[500] = QStringLiteral("int b;");
+    doc.setText(text);
+    doc.setHighlightingMode(QStringLiteral("C++"));
+    KateBuffer &buffer = doc.buffer();
+    buffer.ensureHighlighted(buffer.lines() - 1);
+
+    // lines with equal attributes share them
+    const auto first = buffer.plainLine(0).attributesList();
+    QVERIFY(!first.isEmpty());
+    QCOMPARE(buffer.plainLine(999).attributesList().constData(), first.constData());
+    QVERIFY(buffer.plainLine(500).attributesList().constData() != first.constData());
+
+    // and are accounted once
+    QVERIFY(doc.memoryUsage().attributes < 1000 * first.size() * qint64(sizeof(Kate::TextLine::Attribute)));
+    QVERIFY(doc.memoryUsage().attributes >= first.size() * qint64(sizeof(Kate::TextLine::Attribute)));
+
+    // changing the attributes of one line doesn't touch the others
+    doc.insertText({0, 0}, QStringLiteral("// "));
+    QVERIFY(buffer.plainLine(0).attributesList() != first);
+    QCOMPARE(buffer.plainLine(999).attributesList(), first);
+}
+
+void KateDocumentTest::testMemoryUsage()
+{
+    KTextEditor::DocumentPrivate doc;
+    const auto emptyUsage = doc.memoryUsage();
+    QVERIFY(emptyUsage.text > 0);
+
+    doc.setText(QStringLiteral("some text\n").repeated(1000));
+    const auto usage = doc.memoryUsage();
+    QVERIFY(usage.text >= emptyUsage.text + 1000 * 9 * qint64(sizeof(QChar)));
+    QVERIFY(usage.undo > emptyUsage.undo);
+    QVERIFY(usage.history > 0);
+
+    // changed lines are counted again
+    doc.insertText({0, 0}, QStringLiteral("x").repeated(1000));
+    QVERIFY(doc.memoryUsage().text >= usage.text + 990 * qint64(sizeof(QChar)));
+
+    // cursors are accounted
+    std::unique_ptr<KTextEditor::MovingRange> range(doc.newMovingRange({0, 0, 10, 0}));
+    QVERIFY(doc.memoryUsage().cursors > usage.cursors);
+}
+
+void KateDocumentTest::testLargeFileLoading()
+{
+    // large enough to be loaded progressively if wanted
+    QTemporaryFile file;
+    QVERIFY(file.open());
+    const QByteArray line("line of a file that is large enough to be loaded progressively\n");
+    const int lineCount = int(KATE_BUFFER_PROGRESSIVE_LOADING_SIZE / line.size()) + 1000;
+    file.write(line.repeated(lineCount) + "last line");
+    file.flush();
+
+    // by default large files are decoded on multiple threads, the document is complete once opened
+    {
+        KTextEditor::DocumentPrivate doc;
+        QVERIFY(doc.openUrl(QUrl::fromLocalFile(file.fileName())));
+        QVERIFY(!doc.buffer().isLoading());
+        QCOMPARE(doc.lines(), lineCount + 1);
+        QCOMPARE(doc.line(lineCount), QStringLiteral("last line"));
+    }
+
+    // progressive loading completes from the event loop
+    KTextEditor::DocumentPrivate doc;
+    doc.config()->setValue(KateDocumentConfig::ProgressiveLoading, true);
+    QVERIFY(doc.openUrl(QUrl::fromLocalFile(file.fileName())));
+    QTRY_VERIFY(!doc.buffer().isLoading());
+    QCOMPARE(doc.lines(), lineCount + 1);
+    QCOMPARE(doc.line(lineCount), QStringLiteral("last line"));
+}
@@ -104,6 +104,14 @@ private Q_SLOTS:
     void testDocumentName_data();
     void testDocumentName();
     void testDocumentDeduplication();
+    void testHighlightingInPlace();
+    void testBackgroundHighlighting();
+    void testHighlightingCheckpoints();
+    void testHighlightingCache();
+    void testLongLineHighlighting();
+    void testSharedAttributes();
+    void testMemoryUsage();
+    void testLargeFileLoading();
 };
 
 #endif // KATE_DOCUMENT_TEST_H
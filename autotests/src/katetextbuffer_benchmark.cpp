@@ -0,0 +1,154 @@
+/*
+    SPDX-FileCopyrightText: 2026 KTextEditor contributors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "katetextbuffer_benchmark.h"
+
+#include <katedocument.h>
+#include <katetextbuffer.h>
+
+#include <QRandomGenerator>
+#include <QStandardPaths>
+#include <QStringList>
+#include <QTest>
+
+QTEST_MAIN(KateTextBufferBenchmark)
+
+KateTextBufferBenchmark::KateTextBufferBenchmark()
+    : QObject()
+{
+    QStandardPaths::setTestModeEnabled(true);
+}
+
+/**
+ * Fill the document with the given number of lines and then fragment the blocks
+ * by wrapping and unwrapping lines at random positions, this leaves the buffer
+ * with blocks of non-uniform size like after a long editing session.
+ */
+static void fillFragmentedDocument(KTextEditor::DocumentPrivate &doc, int lines, int edits)
+{
+    QStringList text;
+    text.reserve(lines);
+    for (int i = 0; i < lines; ++i) {
+        text.append(QStringLiteral("This is line number %1 of the benchmark text").arg(i));
+    }
+    doc.setText(text);
+
+    Kate::TextBuffer &buffer = doc.buffer();
+    QRandomGenerator random(42);
+    buffer.startEditing();
+    for (int i = 0; i < edits; ++i) {
+        const int line = random.bounded(buffer.lines());
+        if (i % 3 == 2 && line > 0) {
+            buffer.unwrapLine(line);
+        } else {
+            buffer.wrapLine(KTextEditor::Cursor(line, 0));
+        }
+    }
+    buffer.finishEditing();
+}
+
+void KateTextBufferBenchmark::benchmarkRandomLineAccess_data()
+{
+    QTest::addColumn<int>("lines");
+    QTest::addColumn<int>("edits");
+
+    QTest::newRow("100k lines, unfragmented") << 100000 << 0;
+    QTest::newRow("100k lines, fragmented") << 100000 << 50000;
+    QTest::newRow("1M lines, fragmented") << 1000000 << 200000;
+}
+
+void KateTextBufferBenchmark::benchmarkRandomLineAccess()
+{
+    QFETCH(int, lines);
+    QFETCH(int, edits);
+
+    KTextEditor::DocumentPrivate doc;
+    fillFragmentedDocument(doc, lines, edits);
+    const Kate::TextBuffer &buffer = doc.buffer();
+    QVERIFY(buffer.lines() >= lines);
+
+    // same access pattern for each run
+    std::vector<int> accessedLines(100000);
+    QRandomGenerator random(4711);
+    for (auto &line : accessedLines) {
+        line = random.bounded(buffer.lines());
+    }
+
+    qsizetype sum = 0;
+    QBENCHMARK {
+        for (int line : accessedLines) {
+            sum += buffer.lineLength(line);
+        }
+    }
+    QVERIFY(sum > 0);
+}
+
+void KateTextBufferBenchmark::benchmarkCursorToOffset_data()
+{
+    benchmarkRandomLineAccess_data();
+}
+
+void KateTextBufferBenchmark::benchmarkCursorToOffset()
+{
+    QFETCH(int, lines);
+    QFETCH(int, edits);
+
+    KTextEditor::DocumentPrivate doc;
+    fillFragmentedDocument(doc, lines, edits);
+    const Kate::TextBuffer &buffer = doc.buffer();
+
+    std::vector<KTextEditor::Cursor> cursors(10000);
+    QRandomGenerator random(4711);
+    for (auto &cursor : cursors) {
+        const int line = random.bounded(buffer.lines());
+        cursor = KTextEditor::Cursor(line, random.bounded(buffer.lineLength(line) + 1));
+    }
+
+    // warm up and check correctness
+    for (const auto cursor : cursors) {
+        QCOMPARE(buffer.offsetToCursor(buffer.cursorToOffset(cursor)), cursor);
+    }
+
+    qint64 sum = 0;
+    QBENCHMARK {
+        for (const auto cursor : cursors) {
+            sum += buffer.cursorToOffset(cursor);
+        }
+    }
+    QVERIFY(sum > 0);
+}
+
+void KateTextBufferBenchmark::benchmarkOffsetToCursor_data()
+{
+    benchmarkRandomLineAccess_data();
+}
+
+void KateTextBufferBenchmark::benchmarkOffsetToCursor()
+{
+    QFETCH(int, lines);
+    QFETCH(int, edits);
+
+    KTextEditor::DocumentPrivate doc;
+    fillFragmentedDocument(doc, lines, edits);
+    const Kate::TextBuffer &buffer = doc.buffer();
+
+    const int size = buffer.cursorToOffset(KTextEditor::Cursor(buffer.lines() - 1, buffer.lineLength(buffer.lines() - 1)));
+    std::vector<int> offsets(10000);
+    QRandomGenerator random(4711);
+    for (auto &offset : offsets) {
+        offset = random.bounded(size + 1);
+    }
+
+    qint64 sum = 0;
+    QBENCHMARK {
+        for (const int offset : offsets) {
+            sum += buffer.offsetToCursor(offset).line();
+        }
+    }
+    QVERIFY(sum > 0);
+}
+
+#include "moc_katetextbuffer_benchmark.cpp"
@@ -0,0 +1,28 @@
+/*
+    SPDX-FileCopyrightText: 2026 KTextEditor contributors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef KTEXTEDITOR_KATETEXTBUFFER_BENCHMARK_H
+#define KTEXTEDITOR_KATETEXTBUFFER_BENCHMARK_H
+
+#include <QObject>
+
+class KateTextBufferBenchmark : public QObject
+{
+    Q_OBJECT
+
+public:
+    KateTextBufferBenchmark();
+
+private Q_SLOTS:
+    void benchmarkRandomLineAccess_data();
+    void benchmarkRandomLineAccess();
+    void benchmarkCursorToOffset_data();
+    void benchmarkCursorToOffset();
+    void benchmarkOffsetToCursor_data();
+    void benchmarkOffsetToCursor();
+};
+
+#endif // KTEXTEDITOR_KATETEXTBUFFER_BENCHMARK_H
@@ -14,6 +14,9 @@
 #include "katetextfolding.h"
 #include <ktexteditor/movingcursor.h>
 
+#include <QCryptographicHash>
+#include <QFileInfo>
+#include <QSignalSpy>
 #include <QStandardPaths>
 
 QTEST_MAIN(KateTextBufferTest)
@@ -602,6 +605,452 @@ void KateTextBufferTest::lineLengthLimit()
     }
 }
 
+void KateTextBufferTest::loadWithLateEncodingError()
+{
+    // create temp dir and get file name inside
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString file_path = dir.path() + QLatin1String("/foo");
+
+    // ASCII only lines behind the sniffed prefix, then one Latin-1 line that is invalid UTF-8
+    QByteArray content;
+    for (int i = 0; i < 100000; ++i) {
+        content += "0123456789 ASCII only line\n";
+    }
+    content += "L\xe4st line\n";
+    {
+        QFile f(file_path);
+        QVERIFY(f.open(QIODevice::WriteOnly | QIODevice::Truncate));
+        f.write(content);
+        QVERIFY(f.flush());
+    }
+
+    KTextEditor::DocumentPrivate doc;
+    Kate::TextBuffer buffer(&doc, true);
+    buffer.setTextCodec(QStringLiteral("UTF-8"));
+    buffer.setFallbackTextCodec(QStringLiteral("ISO-8859-1"));
+    bool encodingErrors = false;
+    bool tooLongLinesWrapped = false;
+    int longestLineLoaded = 0;
+    QVERIFY(buffer.load(file_path, encodingErrors, tooLongLinesWrapped, longestLineLoaded, false));
+    QVERIFY(!encodingErrors);
+    QCOMPARE(buffer.lines(), 100002);
+    QCOMPARE(buffer.line(0).text(), QLatin1String("0123456789 ASCII only line"));
+    QCOMPARE(buffer.line(99999).text(), QLatin1String("0123456789 ASCII only line"));
+    QCOMPARE(buffer.line(100000).text(), QString::fromLatin1("L\xe4st line"));
+    QCOMPARE(buffer.line(100001).text(), QString());
+
+    // the digest must still cover the whole file exactly once
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(QByteArray("blob ") + QByteArray::number(content.size()) + '\0');
+    hash.addData(content);
+    QCOMPARE(buffer.digest(), hash.result());
+}
+
+void KateTextBufferTest::loadLargeFileInParallel()
+{
+    // create temp dir and get file name inside
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString file_path = dir.path() + QLatin1String("/foo");
+
+    // large enough to be split into several chunks that are decoded in parallel
+    const int lineCount = 500000;
+    QByteArray content;
+    for (int i = 0; i < lineCount; ++i) {
+        content += "line \xc3\xa4 " + QByteArray::number(i) + " of a file that is large enough to be loaded in parallel\r\n";
+    }
+    content += "last line without eol";
+    {
+        QFile f(file_path);
+        QVERIFY(f.open(QIODevice::WriteOnly | QIODevice::Truncate));
+        f.write(content);
+        QVERIFY(f.flush());
+    }
+
+    KTextEditor::DocumentPrivate doc;
+    Kate::TextBuffer buffer(&doc, true);
+    buffer.setTextCodec(QStringLiteral("UTF-8"));
+    buffer.setFallbackTextCodec(QStringLiteral("ISO-8859-1"));
+    buffer.setEndOfLineMode(Kate::TextBuffer::eolUnix);
+    bool encodingErrors = false;
+    bool tooLongLinesWrapped = false;
+    int longestLineLoaded = 0;
+    QVERIFY(buffer.load(file_path, encodingErrors, tooLongLinesWrapped, longestLineLoaded, false));
+    QVERIFY(!encodingErrors);
+    QVERIFY(!tooLongLinesWrapped);
+    QCOMPARE(buffer.endOfLineMode(), Kate::TextBuffer::eolDos);
+    QCOMPARE(buffer.lines(), lineCount + 1);
+    for (int i : {0, 1, 63, 64, 65, 123456, lineCount - 1}) {
+        QCOMPARE(buffer.line(i).text(), QStringLiteral("line ä %1 of a file that is large enough to be loaded in parallel").arg(i));
+    }
+    QCOMPARE(buffer.line(lineCount).text(), QLatin1String("last line without eol"));
+    QCOMPARE(buffer.cursorToOffset({lineCount, 0}), QString::fromUtf8(content).size() - lineCount - 21);
+
+    // the digest must cover the whole file
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(QByteArray("blob ") + QByteArray::number(content.size()) + '\0');
+    hash.addData(content);
+    QCOMPARE(buffer.digest(), hash.result());
+}
+
+void KateTextBufferTest::saveLargeFileInParallel()
+{
+    // create temp dir and get file names inside
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString file_path = dir.path() + QLatin1String("/foo");
+    const QString saved_path = dir.path() + QLatin1String("/bar");
+
+    // large enough to be encoded in several chunks in parallel
+    const int lineCount = 500000;
+    QByteArray content;
+    for (int i = 0; i < lineCount; ++i) {
+        content += "line \xc3\xa4 " + QByteArray::number(i) + " of a file that is large enough to be saved in parallel\r\n";
+    }
+    content += "last line without eol";
+    {
+        QFile f(file_path);
+        QVERIFY(f.open(QIODevice::WriteOnly | QIODevice::Truncate));
+        f.write(content);
+        QVERIFY(f.flush());
+    }
+
+    KTextEditor::DocumentPrivate doc;
+    Kate::TextBuffer buffer(&doc);
+    buffer.setTextCodec(QStringLiteral("UTF-8"));
+    buffer.setFallbackTextCodec(QStringLiteral("ISO-8859-1"));
+    bool encodingErrors = false;
+    bool tooLongLinesWrapped = false;
+    int longestLineLoaded = 0;
+    QVERIFY(buffer.load(file_path, encodingErrors, tooLongLinesWrapped, longestLineLoaded, false));
+    QCOMPARE(buffer.endOfLineMode(), Kate::TextBuffer::eolDos);
+
+    // split some blocks to get chunks of different block counts
+    buffer.startEditing();
+    buffer.wrapLine({1000, 4});
+    buffer.unwrapLine(1001);
+    buffer.finishEditing();
+
+    // saving must reproduce the file byte by byte
+    QVERIFY(buffer.save(saved_path));
+    QFile f(saved_path);
+    QVERIFY(f.open(QIODevice::ReadOnly));
+    QCOMPARE(f.readAll(), content);
+
+    // the digest was computed while writing
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(QByteArray("blob ") + QByteArray::number(content.size()) + '\0');
+    hash.addData(content);
+    QCOMPARE(buffer.digest(), hash.result());
+}
+
+void KateTextBufferTest::saveComputesDigest_data()
+{
+    QTest::addColumn<QString>("codec");
+    QTest::addColumn<bool>("bom");
+    QTest::addColumn<bool>("digestComputed");
+    QTest::addColumn<QString>("text");
+
+    const QString text = QStringLiteral("ascii\näöü \u20ac \U0001F600\n\nlast");
+    QTest::newRow("UTF-8") << QStringLiteral("UTF-8") << false << true << text;
+    QTest::newRow("UTF-8 with BOM") << QStringLiteral("UTF-8") << true << true << text;
+    QTest::newRow("Latin-1") << QStringLiteral("ISO-8859-1") << false << true << text;
+    QTest::newRow("UTF-16") << QStringLiteral("UTF-16") << true << false << text;
+
+    // lone surrogates are written as replacement character
+    QString loneSurrogates = QStringLiteral("a b\nc d");
+    loneSurrogates[1] = QChar(0xD800);
+    loneSurrogates[6] = QChar(0xDC00);
+    QTest::newRow("UTF-8 with lone surrogates") << QStringLiteral("UTF-8") << false << true << loneSurrogates;
+}
+
+void KateTextBufferTest::saveComputesDigest()
+{
+    QFETCH(QString, codec);
+    QFETCH(bool, bom);
+    QFETCH(bool, digestComputed);
+    QFETCH(QString, text);
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString file_path = dir.path() + QLatin1String("/foo");
+
+    KTextEditor::DocumentPrivate doc;
+    Kate::TextBuffer buffer(&doc);
+    buffer.setTextCodec(codec);
+    buffer.setFallbackTextCodec(QStringLiteral("ISO-8859-1"));
+    buffer.setGenerateByteOrderMark(bom);
+    buffer.setEndOfLineMode(Kate::TextBuffer::eolDos);
+    buffer.startEditing();
+    buffer.insertText({0, 0}, text);
+    buffer.finishEditing();
+    QVERIFY(buffer.save(file_path));
+
+    if (!digestComputed) {
+        QVERIFY(buffer.digest().isEmpty());
+        return;
+    }
+
+    QFile f(file_path);
+    QVERIFY(f.open(QIODevice::ReadOnly));
+    const QByteArray content = f.readAll();
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(QByteArray("blob ") + QByteArray::number(content.size()) + '\0');
+    hash.addData(content);
+    QCOMPARE(buffer.digest(), hash.result());
+}
+
+void KateTextBufferTest::compactLineStorage()
+{
+    // create temp dir and get file name inside
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString file_path = dir.path() + QLatin1String("/foo");
+    const QString saved_path = dir.path() + QLatin1String("/bar");
+
+    // Latin-1 lines, one block in the middle with a line that needs UTF-16
+    const int lineCount = 1000;
+    QString content;
+    for (int i = 0; i < lineCount; ++i) {
+        content += (i == 500) ? QStringLiteral("\u20ac %1\n").arg(i) : QStringLiteral("line \u00e4 %1\n").arg(i);
+    }
+    {
+        QFile f(file_path);
+        QVERIFY(f.open(QIODevice::WriteOnly | QIODevice::Truncate));
+        f.write(content.toUtf8());
+        QVERIFY(f.flush());
+    }
+
+    KTextEditor::DocumentPrivate doc;
+    Kate::TextBuffer buffer(&doc);
+    buffer.setTextCodec(QStringLiteral("UTF-8"));
+    buffer.setFallbackTextCodec(QStringLiteral("ISO-8859-1"));
+    buffer.setCompactLineStorage(true);
+    bool encodingErrors = false;
+    bool tooLongLinesWrapped = false;
+    int longestLineLoaded = 0;
+    QVERIFY(buffer.load(file_path, encodingErrors, tooLongLinesWrapped, longestLineLoaded, false));
+    QVERIFY(!encodingErrors);
+
+    // content is the same as without compact storage
+    QCOMPARE(buffer.lines(), lineCount + 1);
+    QCOMPARE(buffer.text(), content);
+    QCOMPARE(buffer.line(10).text(), QStringLiteral("line \u00e4 10"));
+    QCOMPARE(buffer.lineLength(10), 9);
+    QCOMPARE(buffer.line(500).text(), QStringLiteral("\u20ac 500"));
+    QCOMPARE(buffer.offsetToCursor(buffer.cursorToOffset({700, 3})), KTextEditor::Cursor(700, 3));
+
+    // meta data without highlighting keeps lines compact, real meta data is stored
+    Kate::TextLine textLine = buffer.line(20);
+    buffer.setLineMetaData(20, textLine);
+    textLine.setAutoWrapped(true);
+    buffer.setLineMetaData(21, textLine);
+    QVERIFY(!buffer.line(20).isAutoWrapped());
+    QVERIFY(buffer.line(21).isAutoWrapped());
+    QCOMPARE(buffer.line(21).text(), QStringLiteral("line \u00e4 21"));
+
+    // edits switch back to normal storage, across block borders, too
+    buffer.startEditing();
+    buffer.insertText({100, 0}, QStringLiteral("\u20ac"));
+    buffer.wrapLine({200, 2});
+    buffer.unwrapLine(257);
+    buffer.removeText({{300, 0}, {300, 5}});
+    buffer.finishEditing();
+    QCOMPARE(buffer.line(100).text(), QStringLiteral("\u20acline \u00e4 100"));
+    QCOMPARE(buffer.line(200).text(), QStringLiteral("li"));
+    QCOMPARE(buffer.line(201).text(), QStringLiteral("ne \u00e4 200"));
+    QCOMPARE(buffer.line(256).text(), QStringLiteral("line \u00e4 255line \u00e4 256"));
+    QCOMPARE(buffer.line(300).text(), QStringLiteral("\u00e4 300"));
+    QVERIFY(buffer.line(100).markedAsModified());
+    QVERIFY(!buffer.line(99).markedAsModified());
+
+    // saving works on compact and normal blocks
+    QVERIFY(buffer.save(saved_path));
+    QFile f(saved_path);
+    QVERIFY(f.open(QIODevice::ReadOnly));
+    QCOMPARE(QString::fromUtf8(f.readAll()), buffer.text());
+}
+
+void KateTextBufferTest::loadProgressively()
+{
+    // create temp dir and get file name inside
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString file_path = dir.path() + QLatin1String("/foo");
+
+    const int lineCount = 300000;
+    QByteArray content;
+    for (int i = 0; i < lineCount; ++i) {
+        content += "line " + QByteArray::number(i) + "\n";
+    }
+    {
+        QFile f(file_path);
+        QVERIFY(f.open(QIODevice::WriteOnly | QIODevice::Truncate));
+        f.write(content);
+        QVERIFY(f.flush());
+    }
+
+    KTextEditor::DocumentPrivate doc;
+    Kate::TextBuffer buffer(&doc, true);
+    buffer.setTextCodec(QStringLiteral("UTF-8"));
+    buffer.setFallbackTextCodec(QStringLiteral("ISO-8859-1"));
+    buffer.setProgressiveLoading(true);
+    QSignalSpy finishedSpy(&buffer, &Kate::TextBuffer::loadingFinished);
+    bool encodingErrors = false;
+    bool tooLongLinesWrapped = false;
+    int longestLineLoaded = 0;
+    QVERIFY(buffer.load(file_path, encodingErrors, tooLongLinesWrapped, longestLineLoaded, false));
+
+    // the lines loaded so far are accessible, the rest is appended from the event loop
+    if (buffer.isLoading()) {
+        QVERIFY(buffer.lines() < lineCount + 1);
+        QCOMPARE(buffer.line(0).text(), QStringLiteral("line 0"));
+        QTRY_VERIFY_WITH_TIMEOUT(!buffer.isLoading(), 60000);
+        QCOMPARE(finishedSpy.count(), 1);
+        QVERIFY(!finishedSpy.first().at(0).toBool());
+    }
+    QCOMPARE(buffer.lines(), lineCount + 1);
+    for (int i : {0, 63, 64, 123456, lineCount - 1}) {
+        QCOMPARE(buffer.line(i).text(), QStringLiteral("line %1").arg(i));
+    }
+    QCOMPARE(buffer.cursorToOffset({lineCount, 0}), content.size());
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(QByteArray("blob ") + QByteArray::number(content.size()) + '\0');
+    hash.addData(content);
+    QCOMPARE(buffer.digest(), hash.result());
+
+    // editing completes a running load first
+    QVERIFY(buffer.load(file_path, encodingErrors, tooLongLinesWrapped, longestLineLoaded, false));
+    buffer.startEditing();
+    QVERIFY(!buffer.isLoading());
+    QCOMPARE(buffer.lines(), lineCount + 1);
+    buffer.insertText({lineCount - 1, 0}, QStringLiteral("x"));
+    buffer.finishEditing();
+    QCOMPARE(buffer.line(lineCount - 1).text(), QStringLiteral("xline %1").arg(lineCount - 1));
+
+    // clear aborts a running load
+    QVERIFY(buffer.load(file_path, encodingErrors, tooLongLinesWrapped, longestLineLoaded, false));
+    buffer.clear();
+    QVERIFY(!buffer.isLoading());
+    QCOMPARE(buffer.lines(), 1);
+}
+
+void KateTextBufferTest::loadPaged()
+{
+    // create temp dir and get file name inside
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString file_path = dir.path() + QLatin1String("/foo");
+
+    // large enough to be split into several chunks that are scanned in parallel
+    const int lineCount = 600000;
+    QByteArray content;
+    for (int i = 0; i < lineCount; ++i) {
+        content += "line \xc3\xa4 \xf0\x9f\x98\x80 " + QByteArray::number(i) + " of a file that is large enough to be paged\r\n";
+    }
+    content += "last line without eol";
+    {
+        QFile f(file_path);
+        QVERIFY(f.open(QIODevice::WriteOnly | QIODevice::Truncate));
+        f.write(content);
+        QVERIFY(f.flush());
+    }
+
+    KTextEditor::DocumentPrivate doc;
+    Kate::TextBuffer buffer(&doc, true);
+    buffer.setTextCodec(QStringLiteral("UTF-8"));
+    buffer.setFallbackTextCodec(QStringLiteral("ISO-8859-1"));
+    buffer.setPagedLoading(true);
+    bool encodingErrors = false;
+    bool tooLongLinesWrapped = false;
+    int longestLineLoaded = 0;
+    QVERIFY(buffer.load(file_path, encodingErrors, tooLongLinesWrapped, longestLineLoaded, false));
+    QVERIFY(!encodingErrors);
+    QVERIFY(buffer.isPaged());
+    QCOMPARE(buffer.endOfLineMode(), Kate::TextBuffer::eolDos);
+    QCOMPARE(buffer.lines(), lineCount + 1);
+
+    // the line ends are known without reading the lines
+    QCOMPARE(buffer.cursorToOffset({lineCount, 0}), QString::fromUtf8(content).size() - lineCount - 21);
+
+    // more lines than fit into the cache, read in any order
+    const auto expectedLine = [](int i) {
+        return QStringLiteral("line \u00e4 \U0001F600 %1 of a file that is large enough to be paged").arg(i);
+    };
+    for (int i = 0; i < lineCount; i += 7) {
+        QCOMPARE(buffer.line(i).text(), expectedLine(i));
+    }
+    for (int i : {123456, 0, 64, 63, lineCount - 1}) {
+        QCOMPARE(buffer.line(i).text(), expectedLine(i));
+        QCOMPARE(buffer.lineLength(i), expectedLine(i).size());
+    }
+    QCOMPARE(buffer.line(lineCount).text(), QLatin1String("last line without eol"));
+
+    // edited lines stay in memory
+    buffer.startEditing();
+    buffer.insertText({10, 0}, QStringLiteral("x"));
+    buffer.wrapLine({20, 4});
+    buffer.finishEditing();
+    for (int i = 0; i < lineCount; i += 3) {
+        QVERIFY(!buffer.line(i).text().isEmpty());
+    }
+    QCOMPARE(buffer.line(10).text(), QLatin1Char('x') + expectedLine(10));
+    QCOMPARE(buffer.line(20).text(), QStringLiteral("line"));
+    QCOMPARE(buffer.line(22).text(), expectedLine(21));
+    QCOMPARE(buffer.lines(), lineCount + 2);
+
+    // the digest must cover the whole file
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(QByteArray("blob ") + QByteArray::number(content.size()) + '\0');
+    hash.addData(content);
+    QCOMPARE(buffer.digest(), hash.result());
+
+    // saving is refused, writing the file would lose the lines not read yet
+    QVERIFY(!buffer.save(file_path));
+    QCOMPARE(QFileInfo(file_path).size(), content.size());
+
+    // meta data of paged lines is marked, the mark is gone with the lines
+    buffer.lineForPagedMetaData(300005).markAsFoldingStartAttribute();
+    buffer.setPagedMetaDataTag(300000, 300010, 1);
+    QVERIFY(buffer.hasPagedMetaDataTag(300005, 1));
+    QVERIFY(buffer.line(300005).markedAsFoldingStartAttribute());
+    QVERIFY(!buffer.hasPagedMetaDataTag(300011, 1));
+    QVERIFY(!buffer.hasPagedMetaDataTag(300005, 2));
+    for (int i = 0; i < lineCount; i += 16) {
+        QVERIFY(!buffer.line(i).text().isEmpty());
+    }
+    QVERIFY(!buffer.hasPagedMetaDataTag(300005, 1));
+    QVERIFY(!buffer.line(300005).markedAsFoldingStartAttribute());
+
+    // lines not in memory can't be read once the file changed
+    QSignalSpy changedSpy(&buffer, &Kate::TextBuffer::pagedFileChanged);
+    {
+        QFile f(file_path);
+        QVERIFY(f.open(QIODevice::WriteOnly | QIODevice::Append));
+        f.write("\nanother line");
+        QVERIFY(f.flush());
+    }
+    QVERIFY(buffer.line(5000).text().isEmpty());
+    QVERIFY(buffer.line(5001).text().isEmpty());
+    QCOMPARE(buffer.lines(), lineCount + 2);
+    QCOMPARE(changedSpy.count(), 1);
+
+    // a single carriage return ends a line, too, such files are loaded normally
+    {
+        QFile f(file_path);
+        QVERIFY(f.open(QIODevice::WriteOnly | QIODevice::Append));
+        f.write("\rmac line");
+        QVERIFY(f.flush());
+    }
+    QVERIFY(buffer.load(file_path, encodingErrors, tooLongLinesWrapped, longestLineLoaded, false));
+    QVERIFY(!buffer.isPaged());
+    QCOMPARE(buffer.lines(), lineCount + 3);
+    QCOMPARE(buffer.line(lineCount + 1).text(), QLatin1String("another line"));
+    QCOMPARE(buffer.line(lineCount + 2).text(), QLatin1String("mac line"));
+}
+
 void KateTextBufferTest::testBlockSplittingWithMovingRanges()
 {
     // construct an empty text buffer
@@ -636,6 +1085,52 @@ void KateTextBufferTest::testGetTextWithEmptyFirstBlock()
     QCOMPARE(doc.text().size(), 265);
 }
 
+void KateTextBufferTest::testBulkInsertNearStart()
+{
+    KTextEditor::DocumentPrivate doc;
+    Kate::TextBuffer &buffer = doc.buffer();
+
+    QStringList text;
+    for (int i = 0; i < 1000; ++i) {
+        text.append(QStringLiteral("line %1").arg(i));
+    }
+    doc.setText(text);
+
+    // cursor in the last block, must follow the lines inserted in front of it
+    std::unique_ptr<KTextEditor::MovingCursor> cursor{doc.newMovingCursor(KTextEditor::Cursor(900, 2))};
+
+    // insert many lines near the start, start lines of later blocks are fixed lazily
+    buffer.startEditing();
+    for (int i = 0; i < 500; ++i) {
+        buffer.wrapLine(KTextEditor::Cursor(1 + i, 0));
+        buffer.insertText(KTextEditor::Cursor(1 + i, 0), QStringLiteral("new %1").arg(i));
+
+        // access to lines behind the edit position must still work during the transaction
+        QCOMPARE(buffer.line(buffer.lines() - 1).text(), QStringLiteral("line 999"));
+        QCOMPARE(cursor->toCursor(), KTextEditor::Cursor(901 + i, 2));
+    }
+    buffer.finishEditing();
+
+    QCOMPARE(buffer.lines(), 1500);
+    QCOMPARE(buffer.line(0).text(), QStringLiteral("line 0"));
+    QCOMPARE(buffer.line(1).text(), QStringLiteral("new 0"));
+    QCOMPARE(buffer.line(500).text(), QStringLiteral("new 499"));
+    QCOMPARE(buffer.line(501).text(), QStringLiteral("line 1"));
+    QCOMPARE(buffer.line(1499).text(), QStringLiteral("line 999"));
+    QCOMPARE(cursor->toCursor(), KTextEditor::Cursor(1400, 2));
+
+    // remove them again
+    buffer.startEditing();
+    for (int i = 0; i < 500; ++i) {
+        buffer.removeText(KTextEditor::Range(1, 0, 1, buffer.lineLength(1)));
+        buffer.unwrapLine(2);
+    }
+    buffer.finishEditing();
+
+    QCOMPARE(buffer.text(), text.join(QLatin1Char('\n')));
+    QCOMPARE(cursor->toCursor(), KTextEditor::Cursor(900, 2));
+}
+
 #if HAVE_KAUTH
 void KateTextBufferTest::saveFileWithElevatedPrivileges()
 {
@@ -31,8 +31,17 @@ private Q_SLOTS:
     void nestedFoldingTest();
     void saveFileInUnwritableFolder();
     void lineLengthLimit();
+    void loadWithLateEncodingError();
+    void loadLargeFileInParallel();
+    void loadProgressively();
+    void loadPaged();
+    void compactLineStorage();
+    void saveLargeFileInParallel();
+    void saveComputesDigest_data();
+    void saveComputesDigest();
     void testBlockSplittingWithMovingRanges();
     void testGetTextWithEmptyFirstBlock();
+    void testBulkInsertNearStart();
 
 #if HAVE_KAUTH
     void saveFileWithElevatedPrivileges();
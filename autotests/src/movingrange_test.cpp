@@ -926,3 +926,81 @@ void MovingRangeTest::testBlockSplitAndMerge()
     QVERIFY(!doc.buffer().hasMultlineRange(range2.get()));
     QVERIFY(!doc.buffer().hasMultlineRange(range3.get()));
 }
+
+void MovingRangeTest::testRangesForLineIndex()
+{
+    KTextEditor::DocumentPrivate doc;
+    doc.setText(QStringList(500, QStringLiteral("some text")));
+
+    // single line, block local and multi block ranges
+    std::vector<std::unique_ptr<MovingRange>> ranges;
+    for (int i = 0; i < 490; i += 7) {
+        ranges.emplace_back(doc.newMovingRange({i, 0, i, 4}));
+        ranges.emplace_back(doc.newMovingRange({i, 2, i + 3, 4}));
+        ranges.emplace_back(doc.newMovingRange({i, 5, std::min(i + (i % 150), 499), 1}));
+    }
+
+    // the index must match the ranges after each kind of change
+    const auto checkRangesForLines = [&doc, &ranges]() {
+        for (int line = 0; line < doc.lines(); ++line) {
+            const auto found = doc.buffer().rangesForLine(line, nullptr, false);
+            int expected = 0;
+            for (const auto &range : ranges) {
+                const auto lineRange = range->toLineRange();
+                if (lineRange.isValid() && lineRange.start() <= line && line <= lineRange.end()) {
+                    QVERIFY(found.contains(range.get()));
+                    ++expected;
+                }
+            }
+            QCOMPARE(found.size(), expected);
+        }
+    };
+    checkRangesForLines();
+
+    // line changes, splitting and merging of blocks
+    doc.insertLines(100, QStringList(150, QStringLiteral("more text")));
+    checkRangesForLines();
+    doc.removeText({50, 2, 300, 3});
+    checkRangesForLines();
+    doc.editWrapLine(10, 1);
+    doc.editUnWrapLine(20);
+    checkRangesForLines();
+
+    // moved and invalidated ranges
+    ranges[3]->setRange({5, 0, 200, 2});
+    ranges[4]->setRange({200, 0, 201, 2});
+    ranges[5]->setRange(KTextEditor::Range::invalid());
+    checkRangesForLines();
+}
+
+void MovingRangeTest::testFeedbackAfterTransaction()
+{
+    KTextEditor::DocumentPrivate doc;
+    doc.setText(QStringLiteral("..xxxx..\n..yyyy.."));
+
+    RangeFeedback rf;
+    std::unique_ptr<MovingRange> range(doc.newMovingRange(Range(Cursor(0, 2), Cursor(0, 6)),
+                                                          KTextEditor::MovingRange::ExpandLeft | KTextEditor::MovingRange::ExpandRight,
+                                                          KTextEditor::MovingRange::AllowEmpty));
+    range->setFeedback(&rf);
+    rf.verifyReset();
+
+    // range is only empty in between, no notification at the end of the transaction
+    doc.editStart();
+    doc.removeText(range->toRange());
+    QVERIFY(!rf.rangeEmptyCalled());
+    doc.insertText(range->start(), QStringLiteral("zz"));
+    doc.editEnd();
+    QCOMPARE(range->toRange(), Range(Cursor(0, 2), Cursor(0, 4)));
+    QVERIFY(!rf.rangeEmptyCalled());
+    QVERIFY(!rf.rangeInvalidCalled());
+
+    // range stays empty, notification once the transaction is done
+    doc.editStart();
+    doc.removeText(range->toRange());
+    doc.insertText(Cursor(1, 0), QStringLiteral("zz"));
+    QVERIFY(!rf.rangeEmptyCalled());
+    doc.editEnd();
+    QVERIFY(rf.rangeEmptyCalled());
+    QVERIFY(!rf.rangeInvalidCalled());
+}
@@ -138,3 +138,164 @@ void RevisionTest::testTransformRange()
     QCOMPARE(r2, Range(Cursor(1, 2), Cursor(1, 2)));
     QCOMPARE(invalidOnEmpty, Range::invalid());
 }
+
+// tests:
+// - transformCursor() and transformRange() over runs of revisions with checkpoints
+void RevisionTest::testTransformManyRevisions()
+{
+    KTextEditor::DocumentPrivate doc;
+    doc.setText(QStringList(200, QStringLiteral("0123456789")));
+
+    const qint64 rev = doc.revision();
+    doc.lockRevision(rev);
+
+    // moving cursors and ranges are the reference for the transformations
+    std::vector<std::unique_ptr<KTextEditor::MovingCursor>> cursors;
+    std::vector<std::unique_ptr<KTextEditor::MovingRange>> ranges;
+    for (int line = 0; line < 200; line += 3) {
+        cursors.emplace_back(doc.newMovingCursor({line, 5}, KTextEditor::MovingCursor::MoveOnInsert));
+        ranges.emplace_back(doc.newMovingRange({line, 2, line + 1, 4}));
+    }
+
+    // many edits, mostly in a few lines, some line wraps and unwraps everywhere
+    for (int i = 0; i < 20000; ++i) {
+        const int line = (i % 97 == 0) ? (i * 7) % 180 : 150 + i % 5;
+        if (i % 97 == 0) {
+            doc.editWrapLine(line, std::min(3, doc.lineLength(line)));
+        } else if (i % 101 == 0) {
+            doc.editUnWrapLine(line);
+        } else if (i % 2 || doc.lineLength(line) < 2) {
+            doc.insertText({line, std::min(1, doc.lineLength(line))}, QStringLiteral("x"));
+        } else {
+            doc.removeText({line, 1, line, 2});
+        }
+    }
+
+    for (size_t i = 0; i < cursors.size(); ++i) {
+        const KTextEditor::Cursor original(int(i) * 3, 5);
+        KTextEditor::Cursor transformed = original;
+        doc.transformCursor(transformed, KTextEditor::MovingCursor::MoveOnInsert, rev, -1);
+        QCOMPARE(transformed, cursors[i]->toCursor());
+
+        KTextEditor::Range range(int(i) * 3, 2, int(i) * 3 + 1, 4);
+        doc.transformRange(range, KTextEditor::MovingRange::DoNotExpand, KTextEditor::MovingRange::AllowEmpty, rev, -1);
+        QCOMPARE(range, ranges[i]->toRange());
+    }
+
+    // reverse transform of lines not touched at all
+    KTextEditor::Cursor first(0, 5);
+    doc.transformCursor(first, KTextEditor::MovingCursor::MoveOnInsert, -1, rev);
+    QCOMPARE(first, KTextEditor::Cursor(0, 5));
+    KTextEditor::Cursor last = doc.documentEnd();
+    const int lastLineDelta = doc.lines() - 200;
+    doc.transformCursor(last, KTextEditor::MovingCursor::MoveOnInsert, -1, rev);
+    QCOMPARE(last, KTextEditor::Cursor(doc.documentEnd().line() - lastLineDelta, doc.documentEnd().column()));
+
+    doc.unlockRevision(rev);
+}
+
+// tests:
+// - transformCursors() gives the same results as transformCursor()
+void RevisionTest::testTransformCursors()
+{
+    KTextEditor::DocumentPrivate doc;
+    doc.setText(QStringList(100, QStringLiteral("0123456789")));
+
+    const qint64 rev = doc.revision();
+    doc.lockRevision(rev);
+
+    std::vector<KTextEditor::Cursor> cursors;
+    for (int line = 99; line >= 0; --line) {
+        for (int column : {0, 1, 3, 5, 10}) {
+            cursors.emplace_back(line, column);
+        }
+    }
+    cursors.push_back(KTextEditor::Cursor::invalid());
+
+    // edits on a few lines, wraps and unwraps
+    doc.editStart();
+    for (int i = 0; i < 50; ++i) {
+        const int line = (i * 13) % 90;
+        doc.insertText({line, 3}, QStringLiteral("ab"));
+        doc.editWrapLine(line + 1, 3);
+        doc.removeText({line + 2, 0, line + 2, 2});
+        doc.editUnWrapLine(line + 5);
+    }
+    doc.editEnd();
+
+    // through the public interface
+    KTextEditor::Document &document = doc;
+    for (auto insertBehavior : {KTextEditor::MovingCursor::MoveOnInsert, KTextEditor::MovingCursor::StayOnInsert}) {
+        // forward
+        std::vector<KTextEditor::Cursor> transformed = cursors;
+        document.transformCursors(transformed, insertBehavior, rev);
+        for (size_t i = 0; i < cursors.size(); ++i) {
+            KTextEditor::Cursor expected = cursors[i];
+            doc.transformCursor(expected, insertBehavior, rev);
+            QCOMPARE(transformed[i], expected);
+        }
+
+        // and back
+        std::vector<KTextEditor::Cursor> reverse = transformed;
+        document.transformCursors(reverse, insertBehavior, -1, rev);
+        for (size_t i = 0; i < transformed.size(); ++i) {
+            KTextEditor::Cursor expected = transformed[i];
+            doc.transformCursor(expected, insertBehavior, -1, rev);
+            QCOMPARE(reverse[i], expected);
+        }
+    }
+
+    doc.unlockRevision(rev);
+}
+
+// tests:
+// - locked revisions are kept by default
+// - if wanted, the history doesn't grow without bounds, even if a revision stays locked
+void RevisionTest::testDroppedRevisions()
+{
+    KTextEditor::DocumentPrivate doc;
+    doc.setText(QStringLiteral("0123456789"));
+
+    const qint64 rev = doc.revision();
+    doc.lockRevision(rev);
+
+    // many edits, directly on the buffer to be fast
+    Kate::TextBuffer &buffer = doc.buffer();
+    const auto edit = [&buffer]() {
+        buffer.startEditing();
+        for (int i = 0; i < 4096; ++i) {
+            buffer.insertText({0, 1}, QStringLiteral("x"));
+            buffer.removeText({0, 1, 0, 2});
+        }
+        buffer.finishEditing();
+    };
+    edit();
+
+    // the locked revision is still there
+    KTextEditor::Cursor cursor(0, 5);
+    doc.transformCursor(cursor, KTextEditor::MovingCursor::MoveOnInsert, rev, -1);
+    QCOMPARE(cursor, KTextEditor::Cursor(0, 5));
+
+    // more edits than the bounded history keeps
+    buffer.history().setMaximalHistoryEntries(1024);
+    edit();
+
+    // the locked revision got dropped, transforms from it can't be done any more
+    cursor = KTextEditor::Cursor(0, 5);
+    doc.transformCursor(cursor, KTextEditor::MovingCursor::MoveOnInsert, rev, -1);
+    QVERIFY(!cursor.isValid());
+    KTextEditor::Range range(0, 2, 0, 4);
+    doc.transformRange(range, KTextEditor::MovingRange::DoNotExpand, KTextEditor::MovingRange::AllowEmpty, rev, -1);
+    QVERIFY(!range.isValid());
+
+    // recent revisions are still there
+    const qint64 recent = doc.revision();
+    doc.lockRevision(recent);
+    doc.insertText({0, 0}, QStringLiteral("ab"));
+    cursor = KTextEditor::Cursor(0, 5);
+    doc.transformCursor(cursor, KTextEditor::MovingCursor::MoveOnInsert, recent, -1);
+    QCOMPARE(cursor, KTextEditor::Cursor(0, 7));
+
+    doc.unlockRevision(recent);
+    doc.unlockRevision(rev);
+}
@@ -21,6 +21,9 @@ public:
 private Q_SLOTS:
     void testTransformCursor();
     void testTransformRange();
+    void testTransformManyRevisions();
+    void testTransformCursors();
+    void testDroppedRevisions();
 };
 
 #endif // KATE_REVISION_TEST_H
@@ -9,8 +9,48 @@
 #include "katetextcursor.h"
 #include "katetextrange.h"
 
+#include <algorithm>
+
 namespace Kate
 {
+/**
+ * Can the text be stored as Latin-1 without loss?
+ */
+static bool isLatin1(QStringView text)
+{
+    for (const QChar c : text) {
+        if (c.unicode() > 0xff) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Number of bytes QStringEncoder will produce for the given text in UTF-8.
+ * Lone surrogates are written as replacement character, that takes 3 bytes.
+ */
+static qint64 encodedUtf8Size(QStringView text)
+{
+    qint64 size = text.size();
+    for (qsizetype i = 0; i < text.size(); ++i) {
+        const char16_t c = text[i].unicode();
+        if (c < 0x80) {
+            continue;
+        }
+        if (c < 0x800) {
+            size += 1;
+        } else if (QChar::isHighSurrogate(c) && (i + 1) < text.size() && QChar::isLowSurrogate(text[i + 1].unicode())) {
+            // 4 bytes for the pair
+            size += 2;
+            ++i;
+        } else {
+            size += 2;
+        }
+    }
+    return size;
+}
+
 TextBlock::TextBlock(TextBuffer *buffer, int index)
     : m_buffer(buffer)
     , m_blockIndex(index)
@@ -23,6 +63,7 @@ TextBlock::~TextBlock()
 {
     // blocks should be empty before they are deleted!
     Q_ASSERT(m_lines.empty());
+    Q_ASSERT(!isCompact());
     Q_ASSERT(m_cursors.empty());
 
     // it only is a hint for ranges for this block, not the storage of them
@@ -30,51 +71,243 @@ TextBlock::~TextBlock()
 
 int TextBlock::startLine() const
 {
-    return m_buffer->m_startLines[m_blockIndex];
+    return m_buffer->startLineOfBlock(m_blockIndex);
 }
 
 TextLine TextBlock::line(int line) const
 {
+    ensurePagedIn();
+
+    // compact lines have no meta data, just widen the text
+    if (isCompact()) {
+        return TextLine(lineText(line));
+    }
+
     // right input
     Q_ASSERT(size_t(line) < m_lines.size());
     // get text line, at will bail out on out-of-range
     return m_lines.at(line);
 }
 
+QString TextBlock::lineText(int line) const
+{
+    // right input
+    Q_ASSERT(line >= 0 && line < lines());
+    ensurePagedIn();
+
+    if (isCompact()) {
+        const int start = compactLineStart(line);
+        return QString::fromLatin1(m_compactText.constData() + start, compactLineEnd(line) - start);
+    }
+    return m_lines[line].text();
+}
+
+qint64 TextBlock::utf8Size() const
+{
+    ensurePagedIn();
+
+    // Latin-1 characters above ASCII take 2 bytes
+    if (isCompact()) {
+        const QByteArrayView text(m_compactText.constData(), m_compactLineEnds.back());
+        return text.size() + std::count_if(text.begin(), text.end(), [](char c) {
+                   return uchar(c) >= 0x80;
+               });
+    }
+
+    qint64 size = 0;
+    for (const TextLine &line : m_lines) {
+        size += encodedUtf8Size(line.text());
+    }
+    return size;
+}
+
 void TextBlock::setLineMetaData(int line, const TextLine &textLine)
 {
+    // nothing to store for compact or paged lines if there is no meta data, e.g. without highlighting
+    if ((isCompact() || isPaged()) && !textLine.hasMetaData()) {
+        return;
+    }
+    expand();
+
     // right input
     Q_ASSERT(size_t(line) < m_lines.size());
 
     // set stuff, at will bail out on out-of-range
-    const QString originalText = m_lines.at(line).text();
+    QString originalText = std::move(m_lines.at(line).text());
     m_lines.at(line) = textLine;
-    m_lines.at(line).text() = originalText;
+    m_lines.at(line).text() = std::move(originalText);
+}
+
+TextLine &TextBlock::lineForMetaData(int line)
+{
+    // meta data needs normal storage, the caller will change the line
+    expand();
+
+    // right input
+    Q_ASSERT(size_t(line) < m_lines.size());
+    return m_lines[line];
 }
 
 void TextBlock::appendLine(const QString &textOfLine)
 {
+    expand();
     m_lines.emplace_back(textOfLine);
+    invalidateRangeIndex();
+}
+
+void TextBlock::appendLoadedLine(QStringView textOfLine, bool compactStorage)
+{
+    // only empty or already compact blocks can take compact lines, one line needing UTF-16 switches to normal storage
+    if (!compactStorage || (!isCompact() && !m_lines.empty()) || !isLatin1(textOfLine)) {
+        appendLine(textOfLine.toString());
+        return;
+    }
+
+    // first line: guess the space needed for the whole block, grow it geometrically if not enough
+    if (!isCompact()) {
+        std::vector<TextLine>().swap(m_lines);
+        m_compactLineEnds.reserve(BufferBlockSize);
+        m_compactText.reserve(BufferBlockSize * std::max<qsizetype>(textOfLine.size(), 16));
+    }
+    const qsizetype start = m_compactText.size();
+    const qsizetype end = start + textOfLine.size();
+    if (end > m_compactText.capacity()) {
+        m_compactText.reserve(std::max(end, 2 * m_compactText.capacity()));
+    }
+
+    // narrow the text into the array of the block
+    m_compactText.resize(end);
+    char *data = m_compactText.data() + start;
+    for (const QChar c : textOfLine) {
+        *data++ = char(c.unicode());
+    }
+    m_compactLineEnds.push_back(int(end));
+    invalidateRangeIndex();
+    invalidateMemoryUsage();
 }
 
 void TextBlock::clearLines()
 {
+    m_pageOffset = -1;
+    m_pageLines = 0;
     m_lines.clear();
+    m_compactText = QByteArray();
+    m_compactLineEnds.clear();
+    invalidateRangeIndex();
+    invalidateMemoryUsage();
 }
 
 void TextBlock::text(QString &text) const
 {
+    ensurePagedIn();
+
     // combine all lines
+    if (isCompact()) {
+        for (int i = 0; i < lines(); ++i) {
+            text.append(QLatin1String(m_compactText.constData() + compactLineStart(i), compactLineEnd(i) - compactLineStart(i)));
+            text.append(QLatin1Char('\n'));
+        }
+        return;
+    }
+
     for (const auto &line : m_lines) {
         text.append(line.text());
         text.append(QLatin1Char('\n'));
     }
 }
 
+bool TextBlock::compact()
+{
+    invalidateMemoryUsage();
+
+    // already compact, just drop the space reserved while appending lines
+    if (isCompact()) {
+        m_compactText.squeeze();
+        m_compactLineEnds.shrink_to_fit();
+        return true;
+    }
+
+    // nothing to do, paged blocks might be dropped from memory anyway
+    if (m_lines.empty() || isPaged()) {
+        return false;
+    }
+
+    // only pure Latin-1 text can be stored
+    qsizetype size = 0;
+    for (const auto &line : m_lines) {
+        if (line.hasMetaData() || !isLatin1(line.text())) {
+            return false;
+        }
+        size += line.length();
+    }
+
+    // one array for the text of all lines
+    m_compactText.resize(size);
+    m_compactLineEnds.reserve(m_lines.size());
+    char *data = m_compactText.data();
+    for (const auto &line : m_lines) {
+        for (const QChar c : line.text()) {
+            *data++ = char(c.unicode());
+        }
+        m_compactLineEnds.push_back(int(data - m_compactText.constData()));
+    }
+
+    // free the lines, including the reserved space
+    std::vector<TextLine>().swap(m_lines);
+    return true;
+}
+
+void TextBlock::expand()
+{
+    // called before any change of the lines
+    invalidateMemoryUsage();
+
+    // modified lines of paged blocks can't be read again from the file
+    if (isPaged()) {
+        m_buffer->pinPagedBlock(this);
+        return;
+    }
+
+    if (!isCompact()) {
+        return;
+    }
+
+    std::vector<TextLine> lines;
+    lines.reserve(std::max(BufferBlockSize, this->lines()));
+    for (int i = 0; i < this->lines(); ++i) {
+        lines.emplace_back(lineText(i));
+    }
+    m_lines = std::move(lines);
+
+    m_compactText = QByteArray();
+    std::vector<int>().swap(m_compactLineEnds);
+}
+
+void TextBlock::pageIn() const
+{
+    m_buffer->pageInBlock(m_blockIndex);
+}
+
+void TextBlock::takeLines(TextBlock &block)
+{
+    m_lines = std::move(block.m_lines);
+    block.m_lines.clear();
+    m_compactText = std::move(block.m_compactText);
+    block.m_compactText = QByteArray();
+    m_compactLineEnds = std::move(block.m_compactLineEnds);
+    block.m_compactLineEnds.clear();
+    invalidateRangeIndex();
+    block.invalidateRangeIndex();
+    invalidateMemoryUsage();
+    block.invalidateMemoryUsage();
+}
+
 void TextBlock::wrapLine(const KTextEditor::Cursor position, int fixStartLinesStartIndex)
 {
     // calc internal line
     const int line = position.line() - startLine();
+    expand();
+    invalidateRangeIndex();
 
     // get text, copy, we might invalidate the reference
     const QString text = m_lines.at(line).text();
@@ -112,7 +345,7 @@ void TextBlock::wrapLine(const KTextEditor::Cursor position, int fixStartLinesSt
     // fix all start lines
     // we need to do this NOW, else the range update will FAIL!
     // bug 313759
-    m_buffer->fixStartLines(fixStartLinesStartIndex + 1, 1);
+    m_buffer->fixStartLines(fixStartLinesStartIndex + 1);
 
     // notify the text history
     m_buffer->history().wrapLine(position);
@@ -177,11 +410,16 @@ void TextBlock::wrapLine(const KTextEditor::Cursor position, int fixStartLinesSt
 
 void TextBlock::unwrapLine(int line, TextBlock *previousBlock, int fixStartLinesStartIndex)
 {
+    expand();
+    invalidateRangeIndex();
+
     // two possibilities: either first line of this block or later line
     if (line == 0) {
         // we need previous block with at least one line
         Q_ASSERT(previousBlock);
         Q_ASSERT(previousBlock->lines() > 0);
+        previousBlock->expand();
+        previousBlock->invalidateRangeIndex();
 
         // move last line of previous block to this one, might result in empty block
         const TextLine oldFirst = m_lines.at(0);
@@ -205,7 +443,7 @@ void TextBlock::unwrapLine(int line, TextBlock *previousBlock, int fixStartLines
         // we need to do this NOW, else the range update will FAIL!
         // bug 313759
         Q_ASSERT(fixStartLinesStartIndex + 1 == m_blockIndex);
-        m_buffer->fixStartLines(fixStartLinesStartIndex + 1, -1);
+        m_buffer->fixStartLines(fixStartLinesStartIndex + 1);
 
         // notify the text history in advance
         m_buffer->history().unwrapLine(startLine() + line, oldSizeOfPreviousLine);
@@ -307,7 +545,7 @@ void TextBlock::unwrapLine(int line, TextBlock *previousBlock, int fixStartLines
     // fix all start lines
     // we need to do this NOW, else the range update will FAIL!
     // bug 313759
-    m_buffer->fixStartLines(fixStartLinesStartIndex + 1, -1);
+    m_buffer->fixStartLines(fixStartLinesStartIndex + 1);
 
     // notify the text history in advance
     m_buffer->history().unwrapLine(startLine() + line, oldSizeOfPreviousLine);
@@ -357,6 +595,7 @@ void TextBlock::insertText(const KTextEditor::Cursor position, const QString &te
 {
     // calc internal line
     int line = position.line() - startLine();
+    expand();
 
     // get text
     QString &textOfLine = m_lines.at(line).text();
@@ -426,6 +665,7 @@ void TextBlock::removeText(KTextEditor::Range range, QString &removedText)
 {
     // calc internal line
     int line = range.start().line() - startLine();
+    expand();
 
     // get text
     QString &textOfLine = m_lines.at(line).text();
@@ -494,18 +734,24 @@ void TextBlock::removeText(KTextEditor::Range range, QString &removedText)
 void TextBlock::debugPrint(int blockIndex) const
 {
     // print all blocks
-    for (size_t i = 0; i < m_lines.size(); ++i) {
+    for (int i = 0; i < lines(); ++i) {
+        const QString text = lineText(i);
         printf("%4d - %4llu : %4llu : '%s'\n",
                blockIndex,
                (unsigned long long)startLine() + i,
-               (unsigned long long)m_lines.at(i).text().size(),
-               qPrintable(m_lines.at(i).text()));
+               (unsigned long long)text.size(),
+               qPrintable(text));
     }
 }
 
 void TextBlock::splitBlock(int fromLine, TextBlock *newBlock)
 {
     Q_ASSERT(newBlock->m_cursors.empty());
+    expand();
+    newBlock->expand();
+    invalidateRangeIndex();
+    newBlock->invalidateRangeIndex();
+
     // move lines
     auto myLinesToMoveBegin = m_lines.begin() + fromLine;
     auto myLinesToMoveEnd = m_lines.end();
@@ -551,6 +797,10 @@ void TextBlock::mergeBlock(TextBlock *targetBlock)
     // This function moves everything from *this into *targetBlock.
     // *targetBlock exists before *this with no blocks between.
     // Both this->m_cursors and targetBlock->m_cursors are sorted.
+    expand();
+    targetBlock->expand();
+    invalidateRangeIndex();
+    targetBlock->invalidateRangeIndex();
 
     // Iterating m_cursors backwards to modify TextRange's m_end before m_start.
     std::for_each(m_cursors.crbegin(),
@@ -574,14 +824,35 @@ void TextBlock::mergeBlock(TextBlock *targetBlock)
     m_lines.clear();
 }
 
+void TextBlock::addMemoryUsage(qint64 &text, qint64 &attributes) const
+{
+    if (m_textMemory < 0) {
+        m_textMemory = sizeof(TextBlock) + m_lines.capacity() * sizeof(TextLine) + m_compactText.capacity() + m_compactLineEnds.capacity() * sizeof(int);
+        m_attributesMemory = 0;
+        for (const TextLine &line : m_lines) {
+            m_textMemory += line.text().capacity() * sizeof(QChar);
+
+            // attributes shared among lines are counted by the owner of the shared ones, see TextLine::shareAttributes
+            const auto &attributesList = line.attributesList();
+            if (attributesList.isDetached()) {
+                m_attributesMemory += attributesList.capacity() * sizeof(TextLine::Attribute);
+            }
+        }
+    }
+
+    text += m_textMemory;
+    attributes += m_attributesMemory;
+}
+
 void TextBlock::rangesForLine(const int line, KTextEditor::View *view, bool rangesWithAttributeOnly, QList<TextRange *> &outRanges) const
 {
+    if (!m_rangeIndexValid) {
+        updateRangeIndex();
+    }
+
     const int lineInBlock = line - startLine(); // line number in block
-    for (TextCursor *cursor : std::as_const(m_cursors)) {
-        if (!cursor->kateRange()) {
-            continue;
-        }
-        TextRange *range = cursor->kateRange();
+    for (int i = m_rangeIndexOffsets[lineInBlock]; i < m_rangeIndexOffsets[lineInBlock + 1]; ++i) {
+        TextRange *range = m_rangeIndexRanges[i];
         if (rangesWithAttributeOnly && !range->hasAttribute()) {
             continue;
         }
@@ -596,18 +867,60 @@ void TextBlock::rangesForLine(const int line, KTextEditor::View *view, bool rang
             continue;
         }
 
-        if (
-            // simple case
-            (cursor->lineInBlock() == lineInBlock) ||
-            // if line is in the range, ok
-            (range->startInternal().lineInternal() <= line && line <= range->endInternal().lineInternal())) {
-            outRanges.append(range);
+        outRanges.append(range);
+    }
+}
+
+void TextBlock::updateRangeIndex() const
+{
+    const int blockStart = startLine();
+    const int blockLines = lines();
+
+    // lines of this block each range intersects, ranges with both cursors in this block only once
+    struct LineSpan {
+        int first;
+        int last;
+        TextRange *range;
+    };
+    std::vector<LineSpan> spans;
+    for (TextCursor *cursor : m_cursors) {
+        TextRange *range = cursor->kateRange();
+        if (!range || (cursor == &range->endInternal() && range->startInternal().m_block == this)) {
+            continue;
+        }
+        const int first = std::min(range->startInternal().lineInternal(), blockStart + cursor->lineInBlock()) - blockStart;
+        const int last = std::max(range->endInternal().lineInternal(), blockStart + cursor->lineInBlock()) - blockStart;
+        spans.push_back({std::max(first, 0), std::min(last, blockLines - 1), range});
+    }
+
+    // count the ranges per line, then fill them in
+    m_rangeIndexOffsets.assign(blockLines + 1, 0);
+    for (const auto &span : spans) {
+        for (int line = span.first; line <= span.last; ++line) {
+            ++m_rangeIndexOffsets[line + 1];
         }
     }
+    for (int line = 0; line < blockLines; ++line) {
+        m_rangeIndexOffsets[line + 1] += m_rangeIndexOffsets[line];
+    }
+    m_rangeIndexRanges.resize(m_rangeIndexOffsets[blockLines]);
+    std::vector<int> fill(m_rangeIndexOffsets.begin(), m_rangeIndexOffsets.end() - 1);
+    for (const auto &span : spans) {
+        for (int line = span.first; line <= span.last; ++line) {
+            m_rangeIndexRanges[fill[line]++] = span.range;
+        }
+    }
+
+    m_rangeIndexValid = true;
 }
 
 void TextBlock::markModifiedLinesAsSaved()
 {
+    // compact and paged lines are never modified
+    if (isCompact() || isPaged()) {
+        return;
+    }
+
     // mark all modified lines as saved
     for (auto &textLine : m_lines) {
         if (textLine.markedAsModified()) {
@@ -621,6 +934,7 @@ void TextBlock::insertCursor(Kate::TextCursor *cursor)
     auto it = std::lower_bound(m_cursors.begin(), m_cursors.end(), cursor);
     if (it == m_cursors.end() || cursor != *it) {
         m_cursors.insert(it, cursor);
+        invalidateRangeIndex();
     }
 }
 
@@ -629,6 +943,7 @@ void TextBlock::removeCursor(Kate::TextCursor *cursor)
     auto it = std::lower_bound(m_cursors.begin(), m_cursors.end(), cursor);
     if (it != m_cursors.end() && cursor == *it) {
         m_cursors.erase(it);
+        invalidateRangeIndex();
     }
 }
 }
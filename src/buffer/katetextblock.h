@@ -9,6 +9,7 @@
 
 #include "katetextline.h"
 
+#include <QByteArray>
 #include <QList>
 
 #include <ktexteditor/cursor.h>
@@ -72,6 +73,13 @@ public:
      */
     void setLineMetaData(int line, const TextLine &textLine);
 
+    /**
+     * Access a line to change its non text attributes in place, see TextBuffer::lineForMetaData.
+     * @param line line number, relative to this block
+     * @return text line stored in this block
+     */
+    TextLine &lineForMetaData(int line);
+
     /**
      * Retrieve length for @p line.
      * @param line wanted line number
@@ -80,15 +88,42 @@ public:
     int lineLength(int line) const
     {
         Q_ASSERT(line >= startLine() && (line - startLine()) < lines());
+        ensurePagedIn();
+        if (isCompact()) {
+            return compactLineEnd(line - startLine()) - compactLineStart(line - startLine());
+        }
         return m_lines[line - startLine()].length();
     }
 
+    /**
+     * Retrieve the text of a line, cheaper than line() if only the text is needed.
+     * @param line wanted line number, relative to this block
+     * @return text of the line
+     */
+    QString lineText(int line) const;
+
+    /**
+     * Number of bytes the text of all lines has encoded as UTF-8, without line ends.
+     * Compact blocks are counted on their Latin-1 text, without widening it.
+     * @return size in bytes
+     */
+    qint64 utf8Size() const;
+
     /**
      * Append a new line with given text.
      * @param textOfLine text of the line to append
      */
     void appendLine(const QString &textOfLine);
 
+    /**
+     * Append a new line read from a file.
+     * With compact storage, Latin-1 lines are copied directly into the text array of a compact block,
+     * without creating a TextLine for them, see compact().
+     * @param textOfLine text of the line to append
+     * @param compactStorage use compact storage if possible?
+     */
+    void appendLoadedLine(QStringView textOfLine, bool compactStorage);
+
     /**
      * Clear the lines.
      */
@@ -100,7 +135,38 @@ public:
      */
     int lines() const
     {
-        return static_cast<int>(m_lines.size());
+        if (isPaged()) {
+            return m_pageLines;
+        }
+        return isCompact() ? static_cast<int>(m_compactLineEnds.size()) : static_cast<int>(m_lines.size());
+    }
+
+    /**
+     * Switch to compact storage: store all lines as Latin-1 text in one array.
+     * Only possible if all lines are Latin-1 and have no meta data, see TextLine::hasMetaData.
+     * Accessors widen the lines on the fly, any modification switches back to normal storage.
+     * For already compact blocks, this frees the unused space reserved while loading.
+     * @return block is compact now?
+     */
+    bool compact();
+
+    /**
+     * Are the lines of this block stored in compact form?
+     * @return compact storage used?
+     */
+    bool isCompact() const
+    {
+        return !m_compactLineEnds.empty();
+    }
+
+    /**
+     * Is the text of this block read from the file on demand, see TextBuffer::setPagedLoading?
+     * The lines of such a block might be dropped at any time, until the block gets modified.
+     * @return block is paged?
+     */
+    bool isPaged() const
+    {
+        return m_pageOffset >= 0;
     }
 
     /**
@@ -167,6 +233,30 @@ public:
      */
     KTEXTEDITOR_NO_EXPORT void rangesForLine(int line, KTextEditor::View *view, bool rangesWithAttributeOnly, QList<TextRange *> &outRanges) const;
 
+    /**
+     * Mark the line index of the ranges as outdated, must be called whenever a cursor of this block changes its line.
+     */
+    void invalidateRangeIndex()
+    {
+        m_rangeIndexValid = false;
+    }
+
+    /**
+     * Mark the memory used by the lines as outdated, must be called whenever the lines change, see addMemoryUsage().
+     */
+    void invalidateMemoryUsage()
+    {
+        m_textMemory = -1;
+    }
+
+    /**
+     * Add the memory used by the lines of this block, see TextBuffer::memoryUsage().
+     * Only counted again once the lines changed, attributes shared among lines are not included.
+     * @param text memory of the text and the block itself
+     * @param attributes memory of the highlighting attributes
+     */
+    void addMemoryUsage(qint64 &text, qint64 &attributes) const;
+
     /**
      * Flag all modified text lines as saved on disk.
      */
@@ -185,6 +275,57 @@ public:
     void removeCursor(Kate::TextCursor *cursor);
 
 private:
+    /**
+     * Switch back from compact storage to one TextLine per line, before lines are modified.
+     * Paged blocks are read in and stay in memory from now on.
+     */
+    void expand();
+
+    /**
+     * Make sure the lines of a paged block are in memory, see TextBuffer::pageInBlock.
+     */
+    void ensurePagedIn() const
+    {
+        if (isPaged()) {
+            pageIn();
+        }
+    }
+
+    /**
+     * Read the lines of this paged block, if not already in memory.
+     * Only the cache of paged blocks changes, the text of the block stays the same, therefore allowed for const access.
+     */
+    void pageIn() const;
+
+    /**
+     * Take over all lines of the given block, which will be empty afterwards.
+     * @param block block to take the lines from
+     */
+    void takeLines(TextBlock &block);
+
+    /**
+     * Build the line index of the ranges with cursors in this block, used by rangesForLine().
+     */
+    void updateRangeIndex() const;
+
+    /**
+     * Offset of the given line in m_compactText
+     * @param line line number, relative to this block
+     */
+    int compactLineStart(int line) const
+    {
+        return (line == 0) ? 0 : m_compactLineEnds[line - 1];
+    }
+
+    /**
+     * End offset of the given line in m_compactText
+     * @param line line number, relative to this block
+     */
+    int compactLineEnd(int line) const
+    {
+        return m_compactLineEnds[line];
+    }
+
     /**
      * parent text buffer
      */
@@ -201,10 +342,61 @@ private:
      */
     std::vector<Kate::TextLine> m_lines;
 
+    /**
+     * Text of all lines as Latin-1, used instead of m_lines for compact storage, see compact().
+     */
+    QByteArray m_compactText;
+
+    /**
+     * End offsets of the lines in m_compactText, empty if not compact.
+     */
+    std::vector<int> m_compactLineEnds;
+
+    /**
+     * Position and size of the text of a paged block in the file, -1 if the block is not paged.
+     * The lines are in m_lines only while the block is in the cache of paged blocks, m_pageLines is their number.
+     */
+    qint64 m_pageOffset = -1;
+    qint64 m_pageLength = 0;
+    int m_pageLines = 0;
+
+    /**
+     * Neighbors of a paged block with lines in memory in the list of such blocks, ordered by last use,
+     * the least recently used block is dropped from the cache first, see TextBuffer::pageInBlock.
+     */
+    TextBlock *m_pageNewer = nullptr;
+    TextBlock *m_pageOlder = nullptr;
+
+    /**
+     * Kind of the meta data of the lines [m_pageTagStart, m_pageTagEnd), 0 if none, see TextBuffer::setPagedMetaDataTag.
+     * Reset once the lines of a paged block are dropped from memory.
+     */
+    quint64 m_pageTag = 0;
+    int m_pageTagStart = 0;
+    int m_pageTagEnd = 0;
+
     /**
      * Set of cursors for this block.
      */
     std::vector<TextCursor *> m_cursors;
+
+    /**
+     * Ranges with cursors in this block per line, m_rangeIndexRanges[m_rangeIndexOffsets[line], m_rangeIndexOffsets[line + 1])
+     * are the ranges intersecting the given line of this block. Built on demand, see m_rangeIndexValid.
+     */
+    mutable std::vector<int> m_rangeIndexOffsets;
+    mutable std::vector<TextRange *> m_rangeIndexRanges;
+
+    /**
+     * Is the range index up-to-date?
+     */
+    mutable bool m_rangeIndexValid = false;
+
+    /**
+     * Memory used by the lines, see addMemoryUsage(), m_textMemory is -1 if it needs to be counted again.
+     */
+    mutable qint64 m_textMemory = -1;
+    mutable qint64 m_attributesMemory = 0;
 };
 }
 
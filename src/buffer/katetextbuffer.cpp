@@ -23,14 +23,24 @@
 #define CAN_USE_ERRNO
 #endif
 
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <numeric>
+#include <optional>
+
 #include <QBuffer>
 #include <QCryptographicHash>
+#include <QDateTime>
+#include <QElapsedTimer>
 #include <QFile>
 #include <QFileInfo>
 #include <QScopeGuard>
 #include <QStandardPaths>
+#include <QStringDecoder>
 #include <QStringEncoder>
 #include <QTemporaryFile>
+#include <QThreadPool>
 #include <QVarLengthArray>
 
 #if HAVE_KAUTH
@@ -49,6 +59,249 @@
 
 namespace Kate
 {
+/**
+ * time in milliseconds one batch of a progressive load may take before control goes back to the event loop
+ */
+static constexpr qint64 ProgressiveLoadingBatchTime = 20;
+
+/**
+ * buffers with more characters than this are encoded in parallel on save if the codec allows it
+ */
+static constexpr qint64 ParallelSaveSize = 32 * 1024 * 1024;
+
+/**
+ * characters per chunk for parallel encoding on save, chunks consist of complete blocks
+ */
+static constexpr qint64 ParallelSaveChunkSize = 4 * 1024 * 1024;
+
+/**
+ * number of blocks of a paged buffer with lines in memory, see TextBuffer::setPagedLoading
+ */
+static constexpr size_t PagedBlocksCached = 1024;
+
+struct TextBuffer::LoadingState {
+    LoadingState(const QString &filename, KEncodingProber::ProberType proberType, int lineLengthLimit, int lastRound)
+        : file(filename, proberType, lineLengthLimit)
+        , filename(filename)
+        , lastRound(lastRound)
+    {
+    }
+
+    TextLoader file;
+    QString filename;
+
+    /**
+     * current round and last round to try, see load()
+     */
+    int round = 0;
+    const int lastRound;
+
+    /**
+     * is the current round reading lines via TextLoader::readLine? then the next batch continues there
+     */
+    bool readingLines = false;
+
+    QStringList failedCodecs;
+    qint64 resumePosition = -1;
+
+    bool encodingErrors = false;
+    bool tooLongLinesWrapped = false;
+    int longestLineLoaded = 0;
+};
+
+struct TextBuffer::PagedFile {
+    explicit PagedFile(const QString &filename)
+        : file(filename)
+    {
+    }
+
+    /**
+     * Remove a block from the list of blocks with lines in memory.
+     */
+    void unlink(TextBlock *block)
+    {
+        (block->m_pageNewer ? block->m_pageNewer->m_pageOlder : newestBlock) = block->m_pageOlder;
+        (block->m_pageOlder ? block->m_pageOlder->m_pageNewer : oldestBlock) = block->m_pageNewer;
+        block->m_pageNewer = block->m_pageOlder = nullptr;
+        --cachedBlocks;
+    }
+
+    /**
+     * Add a block as most recently used one to the list of blocks with lines in memory.
+     */
+    void prepend(TextBlock *block)
+    {
+        block->m_pageOlder = newestBlock;
+        (newestBlock ? newestBlock->m_pageNewer : oldestBlock) = block;
+        newestBlock = block;
+        ++cachedBlocks;
+    }
+
+    /**
+     * Did the file change since it was scanned? Then its blocks can't be read again.
+     */
+    bool isChanged()
+    {
+        // size first, it asks the file system again, the modification time is taken from that
+        changed = changed || file.size() != size || file.fileTime(QFileDevice::FileModificationTime) != lastModified;
+        return changed;
+    }
+
+    /**
+     * the loaded file, the lines of the blocks are read from it again
+     */
+    QFile file;
+    QByteArray codec;
+
+    /**
+     * size and modification time of the file when it was scanned
+     */
+    qint64 size = 0;
+    QDateTime lastModified;
+    bool changed = false;
+
+    /**
+     * paged blocks with lines in memory, a list from the most to the least recently used one,
+     * linked via TextBlock::m_pageNewer and TextBlock::m_pageOlder
+     */
+    TextBlock *newestBlock = nullptr;
+    TextBlock *oldestBlock = nullptr;
+    size_t cachedBlocks = 0;
+};
+
+/**
+ * One block of a paged buffer, found by scanPagedChunk
+ */
+struct PagedBlock {
+    qint64 offset = 0;
+    qint64 length = 0;
+    int lines = 0;
+    int size = 0;
+};
+
+/**
+ * Blocks of one chunk of a paged file
+ */
+struct PagedChunk {
+    std::vector<PagedBlock> blocks;
+    int longestLineLoaded = 0;
+
+    /**
+     * end of line types seen in this chunk, the decoded text is not used
+     */
+    TextLoader::ChunkLines lineEnds;
+};
+
+/**
+ * Split one chunk of a file into blocks, by counting line ends and the characters of the lines.
+ * The lines must end up exactly like decoding the chunk would split them, else the chunk can't be paged:
+ * only line feeds or carriage return + line feed end lines, no line is longer than the limit and
+ * UTF-8 has no encoding errors.
+ * @param chunk chunk of the file, see TextLoader::parallelChunks
+ * @param chunkOffset offset of the chunk in the file
+ * @param utf8 is the file UTF-8? else it is Latin-1
+ * @param lastChunk is this the last chunk of the file? then the text after the last line end is a line, too
+ * @param lineLengthLimit limit for line length
+ * @return blocks of the chunk, nothing if the chunk can't be paged
+ */
+static std::optional<PagedChunk> scanPagedChunk(QByteArrayView chunk, qint64 chunkOffset, bool utf8, bool lastChunk, int lineLengthLimit)
+{
+    PagedChunk result;
+    const auto *data = reinterpret_cast<const uchar *>(chunk.data());
+    const qsizetype size = chunk.size();
+    PagedBlock block{.offset = chunkOffset};
+    int lineLength = 0;
+
+    const auto finishLine = [&]() {
+        if (lineLengthLimit > 0 && lineLength > lineLengthLimit) {
+            return false;
+        }
+        result.longestLineLoaded = std::max(result.longestLineLoaded, lineLength);
+        ++block.lines;
+        block.size += lineLength + 1;
+        lineLength = 0;
+        return true;
+    };
+
+    const auto finishBlock = [&](qsizetype end) {
+        block.length = chunkOffset + end - block.offset;
+        result.blocks.push_back(block);
+        block = PagedBlock{.offset = chunkOffset + end};
+    };
+
+    for (qsizetype i = 0; i < size;) {
+        const uchar c = data[i];
+        if (c == '\n' || c == '\r') {
+            // a single carriage return would end a line, too
+            if (c == '\r' && (i + 1 == size || data[i + 1] != '\n')) {
+                return std::nullopt;
+            }
+            if (c == '\r') {
+                result.lineEnds.foundDos = true;
+                ++i;
+            } else {
+                result.lineEnds.foundUnix = true;
+            }
+            ++i;
+            if (!finishLine()) {
+                return std::nullopt;
+            }
+            if (block.lines >= BufferBlockSize) {
+                finishBlock(i);
+            }
+            continue;
+        }
+
+        if (c < 0x80 || !utf8) {
+            ++lineLength;
+            ++i;
+            continue;
+        }
+
+        // only well-formed multi-byte sequences, they have the same number of characters after decoding
+        int length = 0;
+        uchar minSecond = 0x80;
+        uchar maxSecond = 0xbf;
+        if (c >= 0xc2 && c <= 0xdf) {
+            length = 2;
+        } else if (c >= 0xe0 && c <= 0xef) {
+            length = 3;
+            minSecond = (c == 0xe0) ? 0xa0 : minSecond;
+            maxSecond = (c == 0xed) ? 0x9f : maxSecond;
+        } else if (c >= 0xf0 && c <= 0xf4) {
+            length = 4;
+            minSecond = (c == 0xf0) ? 0x90 : minSecond;
+            maxSecond = (c == 0xf4) ? 0x8f : maxSecond;
+        }
+        if (length == 0 || i + length > size || data[i + 1] < minSecond || data[i + 1] > maxSecond) {
+            return std::nullopt;
+        }
+        for (int k = 2; k < length; ++k) {
+            if ((data[i + k] & 0xc0) != 0x80) {
+                return std::nullopt;
+            }
+        }
+
+        // the line separator U+2028 ends a line, too
+        if (c == 0xe2 && data[i + 1] == 0x80 && data[i + 2] == 0xa8) {
+            return std::nullopt;
+        }
+
+        // characters outside of the BMP need a surrogate pair
+        lineLength += (length == 4) ? 2 : 1;
+        i += length;
+    }
+
+    // chunks end with a line feed, only for the last one we need to take care of the remaining text
+    if (lastChunk && !finishLine()) {
+        return std::nullopt;
+    }
+    if (block.lines > 0) {
+        finishBlock(size);
+    }
+    return result;
+}
+
 TextBuffer::TextBuffer(KTextEditor::DocumentPrivate *parent, bool alwaysUseKAuth)
     : QObject(parent)
     , m_document(parent)
@@ -66,6 +319,11 @@ TextBuffer::TextBuffer(KTextEditor::DocumentPrivate *parent, bool alwaysUseKAuth
     , m_lineLengthLimit(4096)
     , m_alwaysUseKAuthForSave(alwaysUseKAuth)
 {
+    // batches of progressive loading are triggered from the event loop
+    m_loadingTimer.setSingleShot(true);
+    m_loadingTimer.setInterval(0);
+    connect(&m_loadingTimer, &QTimer::timeout, this, &TextBuffer::loadNextBatch);
+
     // create initial state, this will set m_revision to 0
     clear();
 }
@@ -139,7 +397,37 @@ void TextBuffer::clear()
     // not allowed during editing
     Q_ASSERT(m_editingTransactions == 0);
 
+    // abort a running progressive load
+    m_loadingTimer.stop();
+    m_loading.reset();
+
+    // insert one block with one empty line
+    resetBlocks();
+
+    // increment revision, we did reset it here in the past
+    // that is no good idea as we can mix up content variants after an reload
+    ++m_revision;
+
+    // reset bom detection
+    m_generateByteOrderMark = false;
+
+    // reset the filter device
+    m_mimeTypeForFilterDev = QStringLiteral("text/plain");
+
+    // clear edit history
+    m_history.clear();
+
+    // we got cleared
+    Q_EMIT cleared();
+}
+
+void TextBuffer::resetBlocks()
+{
+    // the old blocks are gone, no need to page them any more
+    m_paged.reset();
+
     m_multilineRanges.clear();
+    invalidateMultilineRangesIndex();
     invalidateRanges();
 
     // new block for empty buffer
@@ -170,26 +458,12 @@ void TextBuffer::clear()
     // insert one block with one empty line
     m_blocks = {newBlock};
     m_startLines = {0};
+    m_startLinesDirtyFrom = std::numeric_limits<int>::max();
     m_blockSizes = {1};
+    invalidateBlockOffsets(0);
 
     // reset lines and last used block
     m_lines = 1;
-
-    // increment revision, we did reset it here in the past
-    // that is no good idea as we can mix up content variants after an reload
-    ++m_revision;
-
-    // reset bom detection
-    m_generateByteOrderMark = false;
-
-    // reset the filter device
-    m_mimeTypeForFilterDev = QStringLiteral("text/plain");
-
-    // clear edit history
-    m_history.clear();
-
-    // we got cleared
-    Q_EMIT cleared();
 }
 
 TextLine TextBuffer::line(int line) const
@@ -198,7 +472,7 @@ TextLine TextBuffer::line(int line) const
     int blockIndex = blockForLine(line);
 
     // get line
-    return m_blocks.at(blockIndex)->line(line - m_startLines[blockIndex]);
+    return m_blocks.at(blockIndex)->line(line - startLineOfBlock(blockIndex));
 }
 
 void TextBuffer::setLineMetaData(int line, const TextLine &textLine)
@@ -207,7 +481,67 @@ void TextBuffer::setLineMetaData(int line, const TextLine &textLine)
     int blockIndex = blockForLine(line);
 
     // get line
-    return m_blocks.at(blockIndex)->setLineMetaData(line - m_startLines[blockIndex], textLine);
+    return m_blocks.at(blockIndex)->setLineMetaData(line - startLineOfBlock(blockIndex), textLine);
+}
+
+TextLine &TextBuffer::lineForMetaData(int line)
+{
+    // get block, this will assert on invalid line
+    int blockIndex = blockForLine(line);
+
+    // get line
+    return m_blocks.at(blockIndex)->lineForMetaData(line - startLineOfBlock(blockIndex));
+}
+
+TextLine &TextBuffer::lineForPagedMetaData(int line)
+{
+    // get block, this will assert on invalid line
+    const int blockIndex = blockForLine(line);
+    TextBlock *block = m_blocks.at(blockIndex);
+    if (!block->isPaged()) {
+        return block->lineForMetaData(line - startLineOfBlock(blockIndex));
+    }
+
+    // no pinning, the lines might be dropped again
+    pageInBlock(blockIndex);
+    block->invalidateMemoryUsage();
+    return block->m_lines[line - startLineOfBlock(blockIndex)];
+}
+
+void TextBuffer::setPagedMetaDataTag(int startLine, int endLine, quint64 tag)
+{
+    for (int blockIndex = blockForLine(startLine); blockIndex < int(m_blocks.size()); ++blockIndex) {
+        const int blockStartLine = startLineOfBlock(blockIndex);
+        if (blockStartLine > endLine) {
+            break;
+        }
+
+        // lines of paged blocks dropped from memory meanwhile lost their meta data
+        TextBlock *block = m_blocks[blockIndex];
+        if (block->isPaged() && block->m_lines.empty()) {
+            continue;
+        }
+
+        // join the lines with the ones marked before if they touch, else the new ones win
+        const int start = std::max(startLine, blockStartLine) - blockStartLine;
+        const int end = std::min(endLine + 1, blockStartLine + block->lines()) - blockStartLine;
+        if (block->m_pageTag == tag && start <= block->m_pageTagEnd && end >= block->m_pageTagStart) {
+            block->m_pageTagStart = std::min(block->m_pageTagStart, start);
+            block->m_pageTagEnd = std::max(block->m_pageTagEnd, end);
+        } else {
+            block->m_pageTag = tag;
+            block->m_pageTagStart = start;
+            block->m_pageTagEnd = end;
+        }
+    }
+}
+
+bool TextBuffer::hasPagedMetaDataTag(int line, quint64 tag) const
+{
+    const int blockIndex = blockForLine(line);
+    const TextBlock *block = m_blocks[blockIndex];
+    const int blockLine = line - startLineOfBlock(blockIndex);
+    return block->m_pageTag == tag && blockLine >= block->m_pageTagStart && blockLine < block->m_pageTagEnd;
 }
 
 int TextBuffer::cursorToOffset(KTextEditor::Cursor c) const
@@ -216,11 +550,9 @@ int TextBuffer::cursorToOffset(KTextEditor::Cursor c) const
         return -1;
     }
 
-    int off = 0;
     const int blockIndex = blockForLine(c.line());
-    for (auto it = m_blockSizes.begin(), end = m_blockSizes.begin() + blockIndex; it != end; ++it) {
-        off += *it;
-    }
+    ensureBlockOffsetsValid(blockIndex);
+    int off = m_blockOffsets[blockIndex];
 
     auto block = m_blocks[blockIndex];
     int start = block->startLine();
@@ -240,25 +572,24 @@ int TextBuffer::cursorToOffset(KTextEditor::Cursor c) const
 KTextEditor::Cursor TextBuffer::offsetToCursor(int offset) const
 {
     if (offset >= 0) {
-        int off = 0;
-        int blockIdx = 0;
-        for (int blockSize : m_blockSizes) {
-            if (off + blockSize < offset) {
-                off += blockSize;
-            } else {
-                auto block = m_blocks[blockIdx];
-                const int lines = block->lines();
-                int start = block->startLine();
-                int end = start + lines;
-                for (int line = start; line < end; ++line) {
-                    const int len = block->lineLength(line);
-                    if (off + len >= offset) {
-                        return KTextEditor::Cursor(line, offset - off);
-                    }
-                    off += len + 1;
+        // binary search for the block containing the offset
+        // empty blocks share their offset with the next block, upper_bound will skip them
+        ensureBlockOffsetsValid(int(m_blocks.size()) - 1);
+        const auto it = std::upper_bound(m_blockOffsets.begin(), m_blockOffsets.end(), offset);
+        const int blockIdx = static_cast<int>(std::distance(m_blockOffsets.begin(), it)) - 1;
+        int off = m_blockOffsets[blockIdx];
+        if (offset < off + m_blockSizes[blockIdx]) {
+            auto block = m_blocks[blockIdx];
+            const int lines = block->lines();
+            int start = block->startLine();
+            int end = start + lines;
+            for (int line = start; line < end; ++line) {
+                const int len = block->lineLength(line);
+                if (off + len >= offset) {
+                    return KTextEditor::Cursor(line, offset - off);
                 }
+                off += len + 1;
             }
-            blockIdx++;
         }
     }
     return KTextEditor::Cursor::invalid();
@@ -286,6 +617,11 @@ QString TextBuffer::text() const
 
 bool TextBuffer::startEditing()
 {
+    // editing needs the complete file, finish a running progressive load first
+    if (m_editingTransactions == 0 && m_loading) {
+        finishLoading();
+    }
+
     // increment transaction counter
     ++m_editingTransactions;
 
@@ -326,9 +662,32 @@ bool TextBuffer::finishEditing()
     Q_ASSERT(!editingChangedBuffer() || (m_editingMinimalLineChanged >= 0 && m_editingMinimalLineChanged < m_lines));
     Q_ASSERT(!editingChangedBuffer() || (m_editingMaximalLineChanged >= 0 && m_editingMaximalLineChanged < m_lines));
 
+    // apply the deferred start line fixups once for the whole transaction
+    if (!m_blocks.empty()) {
+        ensureStartLinesValid(int(m_blocks.size()) - 1);
+    }
+
     // transaction has finished
     Q_EMIT m_document->KTextEditor::Document::editingFinished(m_document);
 
+    // notify the feedback of all ranges changed by the transaction, once per range
+    // notifications might delete ranges or start new transactions, always take the next one from the queue
+    while (!m_pendingFeedbackNotifications.empty() && m_editingTransactions == 0) {
+        TextRange *range = m_pendingFeedbackNotifications.back();
+        m_pendingFeedbackNotifications.pop_back();
+
+        // slot of a range deleted meanwhile
+        if (!range) {
+            continue;
+        }
+        range->m_pendingFeedbackNotification = -1;
+
+        // invalidated ranges got their notification already when that happened
+        if (range->toRange().isValid()) {
+            range->notifyFeedbackAboutChange();
+        }
+    }
+
     // last transaction finished
     return true;
 }
@@ -351,6 +710,8 @@ void TextBuffer::wrapLine(const KTextEditor::Cursor position)
     ++m_lines; // first alter the line counter, as functions called will need the valid one
     m_blocks.at(blockIndex)->wrapLine(position, blockIndex);
     m_blockSizes[blockIndex] += 1;
+    invalidateBlockOffsets(blockIndex + 1);
+    invalidateMultilineRangesIndex();
 
     // remember changes
     ++m_revision;
@@ -388,14 +749,16 @@ void TextBuffer::unwrapLine(int line)
     int blockIndex = blockForLine(line);
 
     // is this the first line in the block?
-    const int blockStartLine = m_startLines[blockIndex];
+    const int blockStartLine = startLineOfBlock(blockIndex);
     const bool firstLineInBlock = line == blockStartLine;
 
     // let the block handle the unwrapLine
     // this can either lead to one line less in this block or the previous one
     // the previous one could even end up with zero lines
     // this call will trigger fixStartLines
-
+    // it changes the size of this block and for the first line case of the previous one
+    invalidateBlockOffsets(blockIndex);
+    invalidateMultilineRangesIndex();
     m_blocks.at(blockIndex)
         ->unwrapLine(line - blockStartLine, (blockIndex > 0) ? m_blocks.at(blockIndex - 1) : nullptr, firstLineInBlock ? (blockIndex - 1) : blockIndex);
     --m_lines;
@@ -445,6 +808,7 @@ void TextBuffer::insertText(const KTextEditor::Cursor position, const QString &t
     // let the block handle the insertText
     m_blocks.at(blockIndex)->insertText(position, text);
     m_blockSizes[blockIndex] += text.size();
+    invalidateBlockOffsets(blockIndex + 1);
 
     // remember changes
     ++m_revision;
@@ -489,6 +853,7 @@ void TextBuffer::removeText(KTextEditor::Range range)
     QString text;
     m_blocks.at(blockIndex)->removeText(range, text);
     m_blockSizes[blockIndex] -= text.size();
+    invalidateBlockOffsets(blockIndex + 1);
 
     // remember changes
     ++m_revision;
@@ -513,28 +878,40 @@ int TextBuffer::blockForLine(int line) const
         qFatal("out of range line requested in text buffer (%d out of [0, %d])", line, lines());
     }
 
+    // some blocks might have outdated start lines after edits near the start of the buffer
+    // if the line is behind the valid part, fix the start lines block by block until we find it
+    auto validBlocks = std::min(m_blocks.size(), size_t(m_startLinesDirtyFrom));
+    if (validBlocks < m_blocks.size()) {
+        const auto lastValid = validBlocks - 1;
+        if (line >= m_startLines[lastValid] + m_blocks[lastValid]->lines()) {
+            for (size_t i = validBlocks; i < m_blocks.size(); ++i) {
+                m_startLines[i] = m_startLines[i - 1] + m_blocks[i - 1]->lines();
+                m_startLinesDirtyFrom = static_cast<int>(i + 1);
+                if (line < m_startLines[i] + m_blocks[i]->lines()) {
+                    return static_cast<int>(i);
+                }
+            }
+        }
+    }
+
+    // fast path: as long as the blocks are evenly filled, the guessed block is the right one
     auto b = line / BufferBlockSize;
-    if (size_t(b) >= m_blocks.size()) {
-        b = int(m_blocks.size() - 1);
+    if (size_t(b) >= validBlocks) {
+        b = int(validBlocks - 1);
     }
 
     if (m_startLines[b] <= line && line < m_startLines[b] + m_blocks[b]->lines()) {
         return b;
     }
 
-    if (m_startLines[b] > line) {
-        for (int i = b - 1; i >= 0; --i) {
-            if (m_startLines[i] <= line && line < m_startLines[i] + m_blocks[i]->lines()) {
-                return i;
-            }
-        }
-    }
-
-    if (m_startLines[b] < line || (m_blocks[b]->lines() == 0)) {
-        for (size_t i = b + 1; i < m_blocks.size(); ++i) {
-            if (m_startLines[i] <= line && line < m_startLines[i] + m_blocks[i]->lines()) {
-                return static_cast<int>(i);
-            }
+    // after a lot of editing the blocks are no longer uniform, do a binary search on the sorted start lines
+    // empty blocks share their start line with the next block, upper_bound will skip them
+    const auto validEnd = m_startLines.begin() + validBlocks;
+    const auto it = std::upper_bound(m_startLines.begin(), validEnd, line);
+    if (it != m_startLines.begin()) {
+        const int i = static_cast<int>(std::distance(m_startLines.begin(), it)) - 1;
+        if (line < m_startLines[i] + m_blocks[i]->lines()) {
+            return i;
         }
     }
 
@@ -542,16 +919,49 @@ int TextBuffer::blockForLine(int line) const
     return -1;
 }
 
-void TextBuffer::fixStartLines(int startBlock, int value)
+void TextBuffer::fixStartLines(int startBlock)
 {
-    // only allow valid start block
-    Q_ASSERT(startBlock >= 0);
+    // only allow valid start block, the first block always starts at line 0
+    Q_ASSERT(startBlock > 0);
     Q_ASSERT(startBlock <= (int)m_startLines.size());
-    // fixup block
-    for (auto it = m_startLines.begin() + startBlock, end = m_startLines.end(); it != end; ++it) {
-        // move start line by given value
-        *it += value;
+
+    // just remember the first outdated block, the start lines are fixed on demand
+    m_startLinesDirtyFrom = std::min(m_startLinesDirtyFrom, startBlock);
+}
+
+void TextBuffer::ensureStartLinesValid(int index) const
+{
+    Q_ASSERT(index >= 0 && index < (int)m_startLines.size());
+
+    // fixup all outdated blocks up to the wanted one
+    for (int i = m_startLinesDirtyFrom; i <= index; ++i) {
+        m_startLines[i] = m_startLines[i - 1] + m_blocks[i - 1]->lines();
+    }
+
+    // all valid now?
+    m_startLinesDirtyFrom = (index + 1 < (int)m_startLines.size()) ? std::max(m_startLinesDirtyFrom, index + 1) : std::numeric_limits<int>::max();
+}
+
+void TextBuffer::ensureBlockOffsetsValid(int index) const
+{
+    Q_ASSERT(index >= 0 && index < (int)m_blockSizes.size());
+
+    // nothing to do if already valid
+    if (index < m_blockOffsetsDirtyFrom) {
+        return;
     }
+
+    // blocks might have been inserted or removed since last update
+    m_blockOffsets.resize(m_blockSizes.size());
+    m_blockOffsets[0] = 0;
+
+    // sum up the sizes of all outdated blocks up to the wanted one
+    for (int i = std::max(1, m_blockOffsetsDirtyFrom); i <= index; ++i) {
+        m_blockOffsets[i] = m_blockOffsets[i - 1] + m_blockSizes[i - 1];
+    }
+
+    // all valid now?
+    m_blockOffsetsDirtyFrom = (index + 1 < (int)m_blockOffsets.size()) ? (index + 1) : std::numeric_limits<int>::max();
 }
 
 void TextBuffer::balanceBlock(int index)
@@ -571,12 +981,20 @@ void TextBuffer::balanceBlock(int index)
         int halfSize = blockToBalance->lines() / 2;
 
         // create and insert new block after current one, already set right start line
-        const int newBlockStartLine = m_startLines[index] + halfSize;
+        const int newBlockStartLine = startLineOfBlock(index) + halfSize;
         TextBlock *newBlock = new TextBlock(this, index + 1);
         m_blocks.insert(m_blocks.begin() + index + 1, newBlock);
         m_startLines.insert(m_startLines.begin() + index + 1, newBlockStartLine);
         m_blockSizes.insert(m_blockSizes.begin() + index + 1, 0);
 
+        // the sizes of the block and the new one will change by the split
+        invalidateBlockOffsets(index + 1);
+
+        // outdated start lines behind the new block moved by one
+        if (m_startLinesDirtyFrom != std::numeric_limits<int>::max()) {
+            ++m_startLinesDirtyFrom;
+        }
+
         // adjust block indexes
         for (auto it = m_blocks.begin() + index, end = m_blocks.end(); it != end; ++it) {
             (*it)->setBlockIndex(index++);
@@ -599,7 +1017,11 @@ void TextBuffer::balanceBlock(int index)
             m_blocks.erase(m_blocks.begin());
             m_startLines.erase(m_startLines.begin());
             m_blockSizes.erase(m_blockSizes.begin());
-            Q_ASSERT(m_startLines[0] == 0);
+            m_startLines[0] = 0;
+            invalidateBlockOffsets(0);
+            if (m_startLinesDirtyFrom != std::numeric_limits<int>::max()) {
+                m_startLinesDirtyFrom = std::max(1, m_startLinesDirtyFrom - 1);
+            }
             for (auto it = m_blocks.begin(), end = m_blocks.end(); it != end; ++it) {
                 (*it)->setBlockIndex(index++);
             }
@@ -624,6 +1046,12 @@ void TextBuffer::balanceBlock(int index)
     m_blocks.erase(m_blocks.begin() + index);
     m_startLines.erase(m_startLines.begin() + index);
     m_blockSizes.erase(m_blockSizes.begin() + index);
+    invalidateBlockOffsets(index);
+
+    // outdated start lines behind the removed block moved by one
+    if (m_startLinesDirtyFrom != std::numeric_limits<int>::max() && m_startLinesDirtyFrom > index) {
+        --m_startLinesDirtyFrom;
+    }
 
     for (auto it = m_blocks.begin() + index, end = m_blocks.end(); it != end; ++it) {
         (*it)->setBlockIndex(index++);
@@ -656,89 +1084,208 @@ bool TextBuffer::load(const QString &filename, bool &encodingErrors, bool &tooLo
     clear();
 
     // construct the file loader for the given file, with correct prober type
-    Kate::TextLoader file(filename, m_encodingProberType, m_lineLengthLimit);
+    // triple play, maximal three loading rounds, see continueLoading()
+    m_loading = std::make_unique<LoadingState>(filename, m_encodingProberType, m_lineLengthLimit, enforceTextCodec ? 0 : 3);
+    const LoadResult result = continueLoading();
+
+    // report what we know until now, the rest is delivered by loadingFinished() for progressive loading
+    encodingErrors = m_loading->encodingErrors;
+    tooLongLinesWrapped = m_loading->tooLongLinesWrapped;
+    longestLineLoaded = m_loading->longestLineLoaded;
+
+    // progressive loading: append the remaining lines from the event loop
+    if (result == LoadResult::Pending) {
+        m_loadingTimer.start();
+        return true;
+    }
+
+    m_loading.reset();
+    if (result != LoadResult::Finished) {
+        return false;
+    }
+
+    // emit success
+    Q_EMIT loaded(filename, encodingErrors);
+    return true;
+}
+
+void TextBuffer::finishLoading()
+{
+    // read all remaining lines without giving back control
+    const bool progressive = m_progressiveLoading;
+    m_progressiveLoading = false;
+    loadNextBatch();
+    m_progressiveLoading = progressive;
+}
+
+void TextBuffer::loadNextBatch()
+{
+    // nothing to do, if no progressive load is running
+    if (!m_loading) {
+        return;
+    }
+
+    m_loadingTimer.stop();
+    const LoadResult result = continueLoading();
+    if (result == LoadResult::Pending) {
+        m_loadingTimer.start();
+        Q_EMIT loadingProgress();
+        return;
+    }
+
+    // done, a failure to reopen the file for a later round leaves us with one empty line
+    const std::unique_ptr<LoadingState> loading = std::move(m_loading);
+    Q_EMIT loadingProgress();
+    if (result == LoadResult::Finished) {
+        Q_EMIT loaded(loading->filename, loading->encodingErrors);
+    }
+    Q_EMIT loadingFinished(loading->encodingErrors, loading->tooLongLinesWrapped, loading->longestLineLoaded);
+}
+
+TextBuffer::LoadResult TextBuffer::continueLoading()
+{
+    LoadingState &state = *m_loading;
+    TextLoader &file = state.file;
+    const QString &filename = state.filename;
+
+    // lines get appended to the last block, the offsets of it and all blocks after it will change
+    invalidateBlockOffsets(int(m_blocks.size()) - 1);
+
+    // time budget for this batch, only relevant for progressive loading
+    QElapsedTimer batchTimer;
+    batchTimer.start();
 
     // triple play, maximal three loading rounds
     // 0) use the given encoding, be done, if no encoding errors happen
     // 1) use BOM to decided if Unicode or if that fails, use encoding prober, if no encoding errors happen, be done
     // 2) use fallback encoding, be done, if no encoding errors happen
     // 3) use again given encoding, be done in any case
-    for (int i = 0; i < (enforceTextCodec ? 1 : 4); ++i) {
-        // kill all blocks beside first one
-        for (size_t b = 1; b < m_blocks.size(); ++b) {
-            TextBlock *block = m_blocks.at(b);
-            block->clearLines();
-            delete block;
-        }
-        m_blocks.resize(1);
-        m_startLines.resize(1);
-        m_blockSizes.resize(1);
-
-        // remove lines in first block
-        m_blocks.back()->clearLines();
-        m_startLines.back() = 0;
-        m_blockSizes.back() = 0;
-        m_lines = 0;
-
-        // reset error flags
-        tooLongLinesWrapped = false;
-        longestLineLoaded = 0;
-
-        // try to open file, with given encoding
-        // in round 0 + 3 use the given encoding from user
-        // in round 1 use 0, to trigger detection
-        // in round 2 use fallback
-        QString codec = m_textCodec;
-        if (i == 1) {
-            codec.clear();
-        } else if (i == 2) {
-            codec = m_fallbackTextCodec;
-        }
-
-        if (!file.open(codec)) {
-            // create one dummy textline, in any case
-            m_blocks.back()->appendLine(QString());
-            m_lines++;
-            m_blockSizes[0] = 1;
-            return false;
-        }
+    //
+    // to avoid reading large files over and over again:
+    // - rounds 0-2 are skipped if their codec already failed or fails on a bounded prefix of the file
+    // - if all text in front of the line that failed was ASCII, the next round keeps these lines
+    //   and only decodes the remaining part of the file again
+    //
+    // for progressive loading, a round might span multiple calls, state.readingLines is then set
+    for (; state.round <= state.lastRound; ++state.round) {
+        const int i = state.round;
+        if (!state.readingLines) {
+            // try to open file, with given encoding
+            // in round 0 + 3 use the given encoding from user
+            // in round 1 use 0, to trigger detection
+            // in round 2 use fallback
+            QString codec = m_textCodec;
+            if (i == 1) {
+                codec.clear();
+            } else if (i == 2) {
+                codec = m_fallbackTextCodec;
+            }
 
-        // read in all lines...
-        encodingErrors = false;
-        while (!file.eof()) {
-            // read line
-            int offset = 0;
-            int length = 0;
-            bool currentError = !file.readLine(offset, length, tooLongLinesWrapped, longestLineLoaded);
-            encodingErrors = encodingErrors || currentError;
-
-            // bail out on encoding error, if not last round!
-            if (encodingErrors && i < (enforceTextCodec ? 0 : 3)) {
-                BUFFER_DEBUG << "Failed try to load file" << filename << "with codec" << file.textCodec();
-                break;
+            // sniff the encoding on the prefix of the file, the last round is done in any case
+            if (i < state.lastRound) {
+                if (codec.isEmpty()) {
+                    codec = file.detectTextCodec();
+                }
+                if (codec.isEmpty() || state.failedCodecs.contains(codec, Qt::CaseInsensitive) || !file.prefixDecodesWithoutErrors(codec)) {
+                    BUFFER_DEBUG << "Skipped try to load file" << filename << "with codec" << codec;
+                    state.failedCodecs.append(codec);
+                    continue;
+                }
             }
 
-            // ensure blocks aren't too large
-            if (m_blocks.back()->lines() >= BufferBlockSize) {
-                int index = (int)m_blocks.size();
-                int startLine = m_blocks.back()->startLine() + m_blocks.back()->lines();
-                m_blocks.push_back(new TextBlock(this, index));
-                m_startLines.push_back(startLine);
-                m_blockSizes.push_back(0);
+            // continue after the lines loaded without errors by the previous round, if possible
+            const bool resumed = state.resumePosition >= 0 && TextLoader::isAsciiCompatible(codec) && file.resume(codec, state.resumePosition);
+            if (!resumed) {
+                // kill all blocks beside first one, progressive loading might have shown them already
+                resetBlocks();
+
+                // remove lines in first block
+                m_blocks.back()->clearLines();
+                m_blockSizes.back() = 0;
+                m_lines = 0;
+
+                // reset error flags
+                state.tooLongLinesWrapped = false;
+                state.longestLineLoaded = 0;
+
+                if (!file.open(codec)) {
+                    // create one dummy textline, in any case
+                    m_blocks.back()->appendLine(QString());
+                    m_lines++;
+                    m_blockSizes[0] = 1;
+                    return LoadResult::Failed;
+                }
             }
+            state.resumePosition = -1;
+
+            // read in all lines...
+            state.encodingErrors = false;
+            if (!resumed && m_pagedLoading && file.canReadParallel() && loadPaged(filename, file, state.longestLineLoaded)) {
+                // huge files are only scanned for line ends, the lines are read on demand
+            } else if (!resumed && !m_progressiveLoading && file.canReadParallel()) {
+                // large files with simple codecs are decoded and split into blocks on multiple threads
+                state.encodingErrors = loadParallel(file, state.tooLongLinesWrapped, state.longestLineLoaded);
+            } else {
+                state.readingLines = true;
+            }
+        }
 
-            // append line to last block
-            m_blocks.back()->appendLine(QString(file.unicode() + offset, length));
-            m_blockSizes.back() += length + 1;
-            ++m_lines;
+        if (state.readingLines) {
+            while (!file.eof()) {
+                // progressive loading: give back control at a block boundary once the time budget is used up
+                if (m_progressiveLoading && m_blocks.back()->lines() >= BufferBlockSize && batchTimer.hasExpired(ProgressiveLoadingBatchTime)) {
+                    return LoadResult::Pending;
+                }
+
+                // read line
+                int offset = 0;
+                int length = 0;
+                bool currentError = !file.readLine(offset, length, state.tooLongLinesWrapped, state.longestLineLoaded);
+                state.encodingErrors = state.encodingErrors || currentError;
+
+                // bail out on encoding error, if not last round!
+                if (state.encodingErrors && i < state.lastRound) {
+                    BUFFER_DEBUG << "Failed try to load file" << filename << "with codec" << file.textCodec();
+                    state.resumePosition = file.resumePosition(offset);
+                    break;
+                }
+
+                // ensure blocks aren't too large
+                if (m_blocks.back()->lines() >= BufferBlockSize) {
+                    // full blocks won't change any more during loading
+                    if (m_compactLineStorage) {
+                        m_blocks.back()->compact();
+                    }
+
+                    int index = (int)m_blocks.size();
+                    int startLine = m_blocks.back()->startLine() + m_blocks.back()->lines();
+                    m_blocks.push_back(new TextBlock(this, index));
+                    m_startLines.push_back(startLine);
+                    m_blockSizes.push_back(0);
+                }
+
+                // append line to last block
+                m_blocks.back()->appendLoadedLine(QStringView(file.unicode() + offset, length), m_compactLineStorage);
+                m_blockSizes.back() += length + 1;
+                ++m_lines;
+            }
+            state.readingLines = false;
         }
 
         // if no encoding error, break out of reading loop
-        if (!encodingErrors) {
+        if (!state.encodingErrors) {
             // remember used codec, might change bom setting
             setTextCodec(file.textCodec());
             break;
         }
+
+        // don't try this codec again
+        state.failedCodecs.append(file.textCodec());
+    }
+
+    // the last block is complete now, too
+    if (m_compactLineStorage) {
+        m_blocks.back()->compact();
     }
 
     // save checksum of file on disk
@@ -761,7 +1308,7 @@ bool TextBuffer::load(const QString &filename, bool &encodingErrors, bool &tooLo
     Q_ASSERT(m_lines > 0);
 
     // report CODEC + ERRORS
-    BUFFER_DEBUG << "Loaded file " << filename << "with codec" << m_textCodec << (encodingErrors ? "with" : "without") << "encoding errors";
+    BUFFER_DEBUG << "Loaded file " << filename << "with codec" << m_textCodec << (state.encodingErrors ? "with" : "without") << "encoding errors";
 
     // report BOM
     BUFFER_DEBUG << (file.byteOrderMarkFound() ? "Found" : "Didn't find") << "byte order mark";
@@ -769,13 +1316,263 @@ bool TextBuffer::load(const QString &filename, bool &encodingErrors, bool &tooLo
     // report filter device mime-type
     BUFFER_DEBUG << "used filter device for mime-type" << m_mimeTypeForFilterDev;
 
-    // emit success
-    Q_EMIT loaded(filename, encodingErrors);
-
     // file loading worked, modulo encoding problems
+    return LoadResult::Finished;
+}
+
+bool TextBuffer::loadParallel(TextLoader &file, bool &tooLongLinesWrapped, int &longestLineLoaded)
+{
+    // only the initial empty block is allowed to be there, it might already contain cursors
+    Q_ASSERT(m_blocks.size() == 1 && m_lines == 0);
+
+    // per chunk results, each only touched by the worker thread for this chunk
+    struct ChunkBlocks {
+        TextLoader::ChunkLines lines;
+        std::vector<TextBlock *> blocks;
+        std::vector<int> blockSizes;
+    };
+    const std::vector<QByteArrayView> chunks = file.parallelChunks();
+    std::vector<ChunkBlocks> results(chunks.size());
+
+    {
+        QThreadPool pool;
+
+        // compute the digest while decoding
+        pool.start([&file]() {
+            file.digestMappedData();
+        });
+
+        // decode the chunks and build the blocks for them
+        for (size_t i = 0; i < chunks.size(); ++i) {
+            pool.start([this, &file, &chunks, &results, i]() {
+                ChunkBlocks &result = results[i];
+                result.lines = file.decodeChunk(file.availableMappedData(chunks[i]), (i + 1) == chunks.size());
+                for (const auto &[offset, length] : result.lines.lines) {
+                    if (result.blocks.empty() || result.blocks.back()->lines() >= BufferBlockSize) {
+                        result.blocks.push_back(new TextBlock(this, 0));
+                        result.blockSizes.push_back(0);
+                    }
+                    result.blocks.back()->appendLoadedLine(QStringView(result.lines.text.constData() + offset, length), m_compactLineStorage);
+                    result.blockSizes.back() += length + 1;
+                }
+                if (m_compactLineStorage) {
+                    for (TextBlock *block : result.blocks) {
+                        block->compact();
+                    }
+                }
+
+                // free the decoded text early, the lines have their own copy
+                result.lines.text = QString();
+                result.lines.lines = {};
+            });
+        }
+
+        pool.waitForDone();
+    }
+
+    // splice the blocks of all chunks in file order into the buffer
+    bool encodingErrors = false;
+    for (ChunkBlocks &result : results) {
+        encodingErrors = encodingErrors || result.lines.encodingError;
+        tooLongLinesWrapped = tooLongLinesWrapped || result.lines.tooLongLinesWrapped;
+        longestLineLoaded = std::max(longestLineLoaded, result.lines.longestLineLoaded);
+        file.addEndOfLineMode(result.lines);
+
+        for (size_t b = 0; b < result.blocks.size(); ++b) {
+            TextBlock *block = result.blocks[b];
+            if (m_lines == 0) {
+                // keep the initial block, it might contain cursors, just take over the lines
+                m_blocks.front()->takeLines(*block);
+                delete block;
+                m_blockSizes.front() = result.blockSizes[b];
+            } else {
+                block->setBlockIndex(int(m_blocks.size()));
+                m_blocks.push_back(block);
+                m_startLines.push_back(m_lines);
+                m_blockSizes.push_back(result.blockSizes[b]);
+            }
+            m_lines += m_blocks.back()->lines();
+        }
+    }
+
+    return encodingErrors;
+}
+
+bool TextBuffer::loadPaged(const QString &filename, TextLoader &file, int &longestLineLoaded)
+{
+    // only the initial empty block is allowed to be there, it might already contain cursors
+    Q_ASSERT(m_blocks.size() == 1 && m_lines == 0);
+
+    // the lines are read again from the file later on
+    auto paged = std::make_unique<PagedFile>(filename);
+    if (!paged->file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    paged->size = paged->file.size();
+    paged->lastModified = paged->file.fileTime(QFileDevice::FileModificationTime);
+    paged->codec = file.textCodec().toUtf8();
+    const bool utf8 = QStringConverter::encodingForName(paged->codec.constData()) == QStringConverter::Utf8;
+
+    // the scanned data must be the file we read from later on
+    const std::vector<QByteArrayView> chunks = file.parallelChunks();
+    if (chunks.empty() || chunks.back().data() + chunks.back().size() - chunks.front().data() != paged->size) {
+        return false;
+    }
+    std::vector<std::optional<PagedChunk>> results(chunks.size());
+
+    {
+        QThreadPool pool;
+
+        // compute the digest while scanning, even if paging fails, the normal load won't hash the data again
+        pool.start([&file]() {
+            file.digestMappedData();
+        });
+
+        // find the line ends of the chunks
+        for (size_t i = 0; i < chunks.size(); ++i) {
+            pool.start([this, &file, &chunks, &results, utf8, i]() {
+                results[i] = scanPagedChunk(file.availableMappedData(chunks[i]),
+                                            chunks[i].data() - chunks.front().data(),
+                                            utf8,
+                                            (i + 1) == chunks.size(),
+                                            m_lineLengthLimit);
+            });
+        }
+
+        pool.waitForDone();
+    }
+
+    if (std::any_of(results.begin(), results.end(), [](const auto &result) {
+            return !result.has_value();
+        })) {
+        return false;
+    }
+
+    // create the blocks of all chunks in file order, without lines
+    for (std::optional<PagedChunk> &result : results) {
+        longestLineLoaded = std::max(longestLineLoaded, result->longestLineLoaded);
+        file.addEndOfLineMode(result->lineEnds);
+
+        for (const PagedBlock &page : result->blocks) {
+            TextBlock *block = m_blocks.front();
+            if (m_lines == 0) {
+                // keep the initial block, it might contain cursors
+                m_blockSizes.front() = page.size;
+            } else {
+                block = new TextBlock(this, int(m_blocks.size()));
+                m_blocks.push_back(block);
+                m_startLines.push_back(m_lines);
+                m_blockSizes.push_back(page.size);
+            }
+
+            // don't keep the space reserved for the lines, most blocks will never be read
+            std::vector<TextLine>().swap(block->m_lines);
+            block->invalidateMemoryUsage();
+            block->m_pageOffset = page.offset;
+            block->m_pageLength = page.length;
+            block->m_pageLines = page.lines;
+            m_lines += page.lines;
+        }
+    }
+
+    m_paged = std::move(paged);
     return true;
 }
 
+void TextBuffer::pageInBlock(int blockIndex)
+{
+    Q_ASSERT(m_paged && m_blocks[blockIndex]->isPaged());
+    PagedFile &paged = *m_paged;
+    TextBlock *block = m_blocks[blockIndex];
+
+    // lines still in memory, just mark the block as most recently used
+    if (!block->m_lines.empty()) {
+        if (paged.newestBlock != block) {
+            paged.unlink(block);
+            paged.prepend(block);
+        }
+        return;
+    }
+
+    // cache full, drop the lines of the least recently used block
+    if (paged.cachedBlocks >= PagedBlocksCached) {
+        TextBlock *leastRecentlyUsed = paged.oldestBlock;
+        paged.unlink(leastRecentlyUsed);
+        std::vector<TextLine>().swap(leastRecentlyUsed->m_lines);
+        leastRecentlyUsed->m_pageTag = 0;
+        leastRecentlyUsed->invalidateMemoryUsage();
+    }
+    paged.prepend(block);
+    block->invalidateMemoryUsage();
+
+    // the file changed, the text of the block is gone, the lines stay empty until the file is loaded again
+    const bool wasChanged = paged.changed;
+    if (paged.isChanged()) {
+        block->m_lines.resize(block->m_pageLines);
+        if (m_blockSizes[blockIndex] != block->m_pageLines) {
+            m_blockSizes[blockIndex] = block->m_pageLines;
+            invalidateBlockOffsets(blockIndex);
+        }
+        if (!wasChanged) {
+            Q_EMIT pagedFileChanged();
+        }
+        return;
+    }
+
+    // read the text of the block, an initial U+FEFF in it is no byte order mark
+    QByteArray data;
+    if (paged.file.seek(block->m_pageOffset)) {
+        data = paged.file.read(block->m_pageLength);
+    }
+    QStringDecoder decoder(paged.codec.constData(), QStringConverter::Flag::ConvertInitialBom);
+    const QString text = decoder.decode(data);
+
+    // split it like the scan did, the file is unchanged, the lines are the same as scanned
+    qsizetype start = 0;
+    block->m_lines.reserve(block->m_pageLines);
+    while (int(block->m_lines.size()) < block->m_pageLines) {
+        qsizetype end = text.indexOf(QLatin1Char('\n'), start);
+        qsizetype next = end + 1;
+        if (end < 0) {
+            end = next = text.size();
+        } else if (end > start && text.at(end - 1) == QLatin1Char('\r')) {
+            --end;
+        }
+        block->m_lines.emplace_back(text.sliced(start, end - start));
+        start = next;
+    }
+}
+
+void TextBuffer::pinPagedBlock(TextBlock *block)
+{
+    pageInBlock(block->m_blockIndex);
+    m_paged->unlink(block);
+    block->m_pageOffset = -1;
+}
+
+TextBuffer::MemoryUsage TextBuffer::memoryUsage() const
+{
+    MemoryUsage usage;
+
+    // the bookkeeping of the blocks counts as text
+    usage.text += m_blocks.capacity() * sizeof(TextBlock *) + m_startLines.capacity() * sizeof(int) + m_blockSizes.capacity() * sizeof(int)
+        + m_blockOffsets.capacity() * sizeof(int);
+
+    // the lines of a block are only counted again once they changed
+    for (const TextBlock *block : m_blocks) {
+        block->addMemoryUsage(usage.text, usage.attributes);
+        usage.cursors += block->m_cursors.capacity() * sizeof(TextCursor *) + block->m_cursors.size() * sizeof(TextCursor)
+            + block->m_rangeIndexOffsets.capacity() * sizeof(int) + block->m_rangeIndexRanges.capacity() * sizeof(TextRange *);
+    }
+
+    // ranges contain their cursors, these are counted above
+    usage.cursors += m_rangeCount * qint64(sizeof(TextRange) - 2 * sizeof(TextCursor)) + m_multilineRanges.capacity() * sizeof(TextRange *)
+        + m_multilineRangesIndex.capacity() * sizeof(MultilineRangesIndexEntry);
+
+    usage.history = m_history.memoryUsage();
+    return usage;
+}
+
 const QByteArray &TextBuffer::digest() const
 {
     return m_digest;
@@ -811,24 +1608,33 @@ bool TextBuffer::save(const QString &filename)
     // codec must be set, else below we fail!
     Q_ASSERT(!m_textCodec.isEmpty());
 
+    // the lines of a paged buffer are read from the loaded file, writing a file might truncate it before all are read
+    if (isPaged()) {
+        return false;
+    }
+
     // ensure we do not kill symlinks, see bug 498589
     auto realFile = filename;
     if (const auto realFileResolved = QFileInfo(realFile).canonicalFilePath(); !realFileResolved.isEmpty()) {
         realFile = realFileResolved;
     }
 
-    const auto saveRes = saveBufferUnprivileged(realFile);
+    QByteArray digest;
+    const auto saveRes = saveBufferUnprivileged(realFile, digest);
     if (saveRes == SaveResult::Failed) {
         return false;
     }
     if (saveRes == SaveResult::MissingPermissions) {
         // either unit-test mode or we're missing permissions to write to the
         // file => use temporary file and try to use authhelper
-        if (!saveBufferEscalated(realFile)) {
+        if (!saveBufferEscalated(realFile, digest)) {
             return false;
         }
     }
 
+    // remember checksum of file on disk, empty if it could not be computed while writing
+    setDigest(digest);
+
     // remember this revision as last saved
     m_history.setLastSavedRevision();
 
@@ -840,7 +1646,27 @@ bool TextBuffer::save(const QString &filename)
     return true;
 }
 
-bool TextBuffer::saveBuffer(const QString &filename, KCompressionDevice &saveFile)
+qint64 TextBuffer::encodedSize(size_t firstBlock, size_t endBlock, const QString &eol) const
+{
+    const auto encoding = QStringConverter::encodingForName(m_textCodec.toUtf8().constData());
+    Q_ASSERT(encoding && (*encoding == QStringConverter::Utf8 || *encoding == QStringConverter::Latin1));
+
+    qint64 size = 0;
+    int lines = 0;
+    for (size_t b = firstBlock; b < endBlock; ++b) {
+        // one byte per character for Latin-1, block sizes count one extra character per line
+        size += (*encoding == QStringConverter::Latin1) ? (m_blockSizes[b] - m_blocks[b]->lines()) : m_blocks[b]->utf8Size();
+        lines += m_blocks[b]->lines();
+    }
+
+    // all lines beside the last one end with eol
+    if (endBlock == m_blocks.size()) {
+        --lines;
+    }
+    return size + qint64(lines) * eol.size();
+}
+
+bool TextBuffer::saveBuffer(const QString &filename, KCompressionDevice &saveFile, QByteArray &digest)
 {
     // our loved eol string ;)
     QString eol = QStringLiteral("\n");
@@ -871,32 +1697,87 @@ bool TextBuffer::saveBuffer(const QString &filename, KCompressionDevice &saveFil
         }
     }
 
-    // dump the buffer content in right encoding
-    QStringEncoder encoder(m_textCodec.toUtf8().constData());
-    for (int i = 0; i < m_lines; ++i) {
-        // ensure we have enough space in buffer for current line, add bit extra for eol
-        const auto requiredSpace = encoder.requiredSpace(line(i).text().size()) + eolSpace;
-        if (writtenBytesInBuffer + requiredSpace > buffer.size()) {
-            buffer.resize(writtenBytesInBuffer + requiredSpace);
+    // compute the git compatible digest of the written file while writing
+    // the header needs the final size, that can be computed up front for uncompressed files in stateless codecs
+    // if not, the digest stays empty and the file must be read again to get it
+    // not for paged buffers, counting would read all their blocks
+    const auto encoding = QStringConverter::encodingForName(m_textCodec.toUtf8().constData());
+    const bool statelessCodec = encoding && (*encoding == QStringConverter::Utf8 || *encoding == QStringConverter::Latin1);
+    const bool computeDigest = statelessCodec && !isPaged() && saveFile.compressionType() == KCompressionDevice::None;
+    const qint64 bomSize = writtenBytesInBuffer;
+    std::optional<QCryptographicHash> hash;
+    qint64 expectedSize = -1;
+    const auto beginDigest = [&hash, &expectedSize, bomSize](qint64 textSize) {
+        expectedSize = bomSize + textSize;
+        hash.emplace(QCryptographicHash::Sha1);
+        const QString header = QStringLiteral("blob %1").arg(expectedSize);
+        hash->addData(QByteArray(header.toLatin1() + '\0'));
+    };
+    qint64 writtenBytes = 0;
+    const auto write = [&saveFile, &hash, &writtenBytes](QByteArrayView data) {
+        if (hash) {
+            hash->addData(data);
+        }
+        writtenBytes += data.size();
+        return saveFile.write(data.data(), data.size()) == data.size();
+    };
+
+    // large buffers with stateless codecs are encoded on multiple threads
+    // not for paged buffers, reading their blocks on demand is not thread-safe
+    qint64 characters = 0;
+    for (int size : m_blockSizes) {
+        characters += size;
+    }
+    if (!isPaged() && characters >= ParallelSaveSize && statelessCodec) {
+        // the encoded size is counted by the workers, then the BOM is written first, if any
+        const auto begin = [&](qint64 textSize) {
+            if (computeDigest) {
+                beginDigest(textSize);
+            }
+            return bomSize == 0 || write(QByteArrayView(buffer.constData(), bomSize));
+        };
+        if (!saveBufferParallel(write, eol, begin)) {
+            return false;
+        }
+    } else {
+        // small buffers are counted in one go, that's cheap compared to the encoding below
+        if (computeDigest) {
+            beginDigest(encodedSize(0, m_blocks.size(), eol));
         }
 
-        // write line and re-compute current written bytes
-        const auto end = encoder.appendToBuffer(buffer.data() + writtenBytesInBuffer, line(i).text());
-        writtenBytesInBuffer = (end - buffer.data());
+        // dump the buffer content in right encoding
+        QStringEncoder encoder(m_textCodec.toUtf8().constData());
+        int lineNumber = 0;
+        for (const TextBlock *block : m_blocks) {
+            for (int l = 0; l < block->lines(); ++l) {
+                const QString text = block->lineText(l);
+                const bool lastLine = (++lineNumber == m_lines);
+
+                // ensure we have enough space in buffer for current line, add bit extra for eol
+                const auto requiredSpace = encoder.requiredSpace(text.size()) + eolSpace;
+                if (writtenBytesInBuffer + requiredSpace > buffer.size()) {
+                    buffer.resize(writtenBytesInBuffer + requiredSpace);
+                }
 
-        // write correctly encoded eol & re-compute current written bytes
-        if ((i + 1) < m_lines) {
-            const auto eolEnd = encoder.appendToBuffer(buffer.data() + writtenBytesInBuffer, eol);
-            writtenBytesInBuffer = (eolEnd - buffer.data());
-        }
+                // write line and re-compute current written bytes
+                const auto end = encoder.appendToBuffer(buffer.data() + writtenBytesInBuffer, text);
+                writtenBytesInBuffer = (end - buffer.data());
 
-        // flush to file if end of file or we have enough in buffer
-        if ((i + 1) == m_lines || writtenBytesInBuffer > (buffer.size() / 2)) {
-            // if we can't write all bytes => error out
-            if (writtenBytesInBuffer > 0 && saveFile.write(buffer.constData(), writtenBytesInBuffer) != writtenBytesInBuffer) {
-                return false;
+                // write correctly encoded eol & re-compute current written bytes
+                if (!lastLine) {
+                    const auto eolEnd = encoder.appendToBuffer(buffer.data() + writtenBytesInBuffer, eol);
+                    writtenBytesInBuffer = (eolEnd - buffer.data());
+                }
+
+                // flush to file if end of file or we have enough in buffer
+                if (lastLine || writtenBytesInBuffer > (buffer.size() / 2)) {
+                    // if we can't write all bytes => error out
+                    if (writtenBytesInBuffer > 0 && !write(QByteArrayView(buffer.constData(), writtenBytesInBuffer))) {
+                        return false;
+                    }
+                    writtenBytesInBuffer = 0;
+                }
             }
-            writtenBytesInBuffer = 0;
         }
     }
 
@@ -909,10 +1790,122 @@ bool TextBuffer::saveBuffer(const QString &filename, KCompressionDevice &saveFil
         return false;
     }
 
+    // the size prediction might be off for broken text, e.g. a lone surrogate at the end of the last line
+    digest = (hash && writtenBytes == expectedSize) ? hash->result() : QByteArray();
     return true;
 }
 
-TextBuffer::SaveResult TextBuffer::saveBufferUnprivileged(const QString &filename)
+bool TextBuffer::saveBufferParallel(const std::function<bool(QByteArrayView)> &write,
+                                    const QString &eol,
+                                    const std::function<bool(qint64)> &begin)
+{
+    // group the blocks to chunks of similar size
+    struct Chunk {
+        size_t firstBlock = 0;
+        size_t endBlock = 0;
+        int firstLine = 0;
+        QByteArray data;
+        bool done = false;
+    };
+    std::vector<Chunk> chunks;
+    qint64 chunkSize = 0;
+    for (size_t b = 0; b < m_blocks.size(); ++b) {
+        if (chunks.empty() || chunkSize >= ParallelSaveChunkSize) {
+            chunks.push_back({b, b, startLineOfBlock(int(b)), {}, false});
+            chunkSize = 0;
+        }
+        chunks.back().endBlock = b + 1;
+        chunkSize += m_blockSizes[b];
+    }
+
+    // count the encoded size of the chunks first, in parallel, the writer needs the total up front
+    {
+        std::vector<qint64> chunkSizes(chunks.size());
+        QThreadPool pool;
+        for (size_t c = 0; c < chunks.size(); ++c) {
+            pool.start([this, &chunks, &chunkSizes, &eol, c]() {
+                chunkSizes[c] = encodedSize(chunks[c].firstBlock, chunks[c].endBlock, eol);
+            });
+        }
+        pool.waitForDone();
+        if (!begin(std::accumulate(chunkSizes.begin(), chunkSizes.end(), qint64(0)))) {
+            return false;
+        }
+    }
+
+    // encoded chunks are handed over to the writer below, the buffer is not modified meanwhile
+    const QByteArray codec = m_textCodec.toUtf8();
+    std::mutex mutex;
+    std::condition_variable chunkDone;
+    std::atomic<bool> canceled = false;
+    const auto encodeChunk = [this, &chunks, &codec, &eol, &mutex, &chunkDone, &canceled](size_t index) {
+        QByteArray data;
+        if (!canceled) {
+            QStringEncoder encoder(codec.constData());
+            const Chunk &chunk = chunks[index];
+            qsizetype requiredSpace = 0;
+            for (size_t b = chunk.firstBlock; b < chunk.endBlock; ++b) {
+                requiredSpace += encoder.requiredSpace(m_blockSizes[b] + m_blocks[b]->lines() * eol.size());
+            }
+            data.resize(requiredSpace);
+            char *end = data.data();
+            int lineNumber = chunk.firstLine;
+            for (size_t b = chunk.firstBlock; b < chunk.endBlock; ++b) {
+                const TextBlock *block = m_blocks[b];
+                for (int l = 0; l < block->lines(); ++l) {
+                    end = encoder.appendToBuffer(end, block->lineText(l));
+                    if (++lineNumber < m_lines) {
+                        end = encoder.appendToBuffer(end, eol);
+                    }
+                }
+            }
+            data.truncate(end - data.constData());
+        }
+
+        {
+            std::lock_guard lock(mutex);
+            chunks[index].data = std::move(data);
+            chunks[index].done = true;
+        }
+        chunkDone.notify_all();
+    };
+
+    // write the chunks in order while the next ones get encoded
+    // only a window of chunks is in flight, to not keep the whole encoded file in memory
+    QThreadPool pool;
+    const size_t window = 2 * size_t(std::max(1, pool.maxThreadCount()));
+    size_t started = 0;
+    bool success = true;
+    for (size_t c = 0; c < chunks.size(); ++c) {
+        for (; started < chunks.size() && started < c + window; ++started) {
+            pool.start([&encodeChunk, started]() {
+                encodeChunk(started);
+            });
+        }
+
+        QByteArray data;
+        {
+            std::unique_lock lock(mutex);
+            chunkDone.wait(lock, [&chunks, c]() {
+                return chunks[c].done;
+            });
+            data = std::move(chunks[c].data);
+        }
+
+        // if we can't write all bytes => error out
+        if (!data.isEmpty() && !write(data)) {
+            success = false;
+            break;
+        }
+    }
+
+    // let the remaining tasks finish fast
+    canceled = !success;
+    pool.waitForDone();
+    return success;
+}
+
+TextBuffer::SaveResult TextBuffer::saveBufferUnprivileged(const QString &filename, QByteArray &digest)
 {
     if (m_alwaysUseKAuthForSave) {
         // unit-testing mode, simulate we need privileges
@@ -934,14 +1927,14 @@ TextBuffer::SaveResult TextBuffer::saveBufferUnprivileged(const QString &filenam
         return SaveResult::MissingPermissions;
     }
 
-    if (!saveBuffer(filename, *saveFile)) {
+    if (!saveBuffer(filename, *saveFile, digest)) {
         return SaveResult::Failed;
     }
 
     return SaveResult::Success;
 }
 
-bool TextBuffer::saveBufferEscalated(const QString &filename)
+bool TextBuffer::saveBufferEscalated(const QString &filename, QByteArray &digest)
 {
 #if HAVE_KAUTH
     // construct correct filter device
@@ -975,7 +1968,7 @@ bool TextBuffer::saveBufferEscalated(const QString &filename)
         return false;
     }
 
-    if (!saveBuffer(filename, *saveFile)) {
+    if (!saveBuffer(filename, *saveFile, digest)) {
         return false;
     }
 
@@ -1032,6 +2025,7 @@ bool TextBuffer::saveBufferEscalated(const QString &filename)
     return true;
 #else
     Q_UNUSED(filename);
+    Q_UNUSED(digest);
     return false;
 #endif
 }
@@ -1069,13 +2063,31 @@ void TextBuffer::addMultilineRange(TextRange *range)
     auto it = std::find(m_multilineRanges.begin(), m_multilineRanges.end(), range);
     if (it == m_multilineRanges.end()) {
         m_multilineRanges.push_back(range);
+        invalidateMultilineRangesIndex();
         return;
     }
 }
 
+void TextBuffer::addPendingFeedbackNotification(TextRange *range)
+{
+    if (range->m_pendingFeedbackNotification < 0) {
+        range->m_pendingFeedbackNotification = qsizetype(m_pendingFeedbackNotifications.size());
+        m_pendingFeedbackNotifications.push_back(range);
+    }
+}
+
+void TextBuffer::removePendingFeedbackNotification(TextRange *range)
+{
+    // just clear the slot, finishEditing() skips it, the queue is only appended to and taken from the back
+    Q_ASSERT(m_pendingFeedbackNotifications[range->m_pendingFeedbackNotification] == range);
+    m_pendingFeedbackNotifications[range->m_pendingFeedbackNotification] = nullptr;
+    range->m_pendingFeedbackNotification = -1;
+}
+
 void TextBuffer::removeMultilineRange(TextRange *range)
 {
     m_multilineRanges.erase(std::remove(m_multilineRanges.begin(), m_multilineRanges.end(), range), m_multilineRanges.end());
+    invalidateMultilineRangesIndex();
 }
 
 bool TextBuffer::hasMultlineRange(KTextEditor::MovingRange *range) const
@@ -1089,30 +2101,79 @@ void TextBuffer::rangesForLine(int line, KTextEditor::View *view, bool rangesWit
     // get block, this will assert on invalid line
     const int blockIndex = blockForLine(line);
     m_blocks.at(blockIndex)->rangesForLine(line, view, rangesWithAttributeOnly, outRanges);
-    // printf("Requested range for line %d, available %d\n", (int)line, (int)m_multilineRanges.size());
-    for (TextRange *range : std::as_const(m_multilineRanges)) {
-        if (rangesWithAttributeOnly && !range->hasAttribute()) {
-            continue;
+
+    // ranges spanning multiple blocks are looked up in the interval index
+    if (!m_multilineRanges.empty()) {
+        if (!m_multilineRangesIndexValid) {
+            updateMultilineRangesIndex();
         }
+        multilineRangesForLine(0, m_multilineRangesIndex.size(), line, view, rangesWithAttributeOnly, outRanges);
+    }
 
-        // we want ranges for no view, but this one's attribute is only valid for views
-        if (!view && range->attributeOnlyForViews()) {
-            continue;
+    std::sort(outRanges.begin(), outRanges.end());
+    outRanges.erase(std::unique(outRanges.begin(), outRanges.end()), outRanges.end());
+}
+
+void TextBuffer::updateMultilineRangesIndex() const
+{
+    // sort by start line, the index is an implicit balanced binary search tree over this array
+    m_multilineRangesIndex.clear();
+    m_multilineRangesIndex.reserve(m_multilineRanges.size());
+    for (TextRange *range : m_multilineRanges) {
+        m_multilineRangesIndex.push_back({range->startInternal().lineInternal(), range->endInternal().lineInternal(), 0, range});
+    }
+    std::sort(m_multilineRangesIndex.begin(), m_multilineRangesIndex.end(), [](const auto &a, const auto &b) {
+        return a.startLine < b.startLine;
+    });
+
+    // remember the maximal end line of each subtree in its root
+    const auto updateMaxEndLine = [this](const auto &self, size_t begin, size_t end) -> int {
+        if (begin >= end) {
+            return -1;
         }
+        const size_t middle = begin + (end - begin) / 2;
+        auto &entry = m_multilineRangesIndex[middle];
+        entry.maxEndLine = std::max({entry.endLine, self(self, begin, middle), self(self, middle + 1, end)});
+        return entry.maxEndLine;
+    };
+    updateMaxEndLine(updateMaxEndLine, 0, m_multilineRangesIndex.size());
+
+    m_multilineRangesIndexValid = true;
+}
 
-        // the range's attribute is not valid for this view
-        if (range->view() && range->view() != view) {
+void TextBuffer::multilineRangesForLine(size_t begin,
+                                        size_t end,
+                                        int line,
+                                        KTextEditor::View *view,
+                                        bool rangesWithAttributeOnly,
+                                        QList<TextRange *> &outRanges) const
+{
+    while (begin < end) {
+        const size_t middle = begin + (end - begin) / 2;
+        const auto &entry = m_multilineRangesIndex[middle];
+
+        // no range in this subtree reaches the line
+        if (entry.maxEndLine < line) {
+            return;
+        }
+
+        // this range and all in the right subtree start behind the line
+        if (entry.startLine > line) {
+            end = middle;
             continue;
         }
 
         // if line is in the range, ok
-        if (range->startInternal().lineInternal() <= line && line <= range->endInternal().lineInternal()) {
+        TextRange *range = entry.range;
+        if (line <= entry.endLine && (!rangesWithAttributeOnly || range->hasAttribute()) && (view || !range->attributeOnlyForViews())
+            && (!range->view() || range->view() == view)) {
             outRanges.append(range);
         }
+
+        // both subtrees might contain matches, descend left, continue right
+        multilineRangesForLine(begin, middle, line, view, rangesWithAttributeOnly, outRanges);
+        begin = middle + 1;
     }
-    std::sort(outRanges.begin(), outRanges.end());
-    outRanges.erase(std::unique(outRanges.begin(), outRanges.end()), outRanges.end());
-}
 }
 
 #include "moc_katetextbuffer.cpp"
@@ -6,10 +6,15 @@
 #ifndef KATE_TEXTBUFFER_H
 #define KATE_TEXTBUFFER_H
 
+#include <functional>
+#include <limits>
+#include <memory>
+
 #include <QList>
 #include <QObject>
 #include <QSet>
 #include <QString>
+#include <QTimer>
 
 #include "katetextblock.h"
 #include "katetexthistory.h"
@@ -30,6 +35,7 @@ namespace Kate
 class TextRange;
 class TextCursor;
 class TextBlock;
+class TextLoader;
 
 constexpr int BufferBlockSize = 64;
 
@@ -177,6 +183,16 @@ public:
         m_lineLengthLimit = lineLengthLimit;
     }
 
+    /**
+     * Set compact line storage for loading
+     * If enabled, load() stores blocks with only Latin-1 text in 8-bit form, see TextBlock::compact.
+     * @param compact use compact line storage?
+     */
+    void setCompactLineStorage(bool compact)
+    {
+        m_compactLineStorage = compact;
+    }
+
     /**
      * Load the given file. This will first clear the buffer and then load the file.
      * Even on error during loading the buffer will still be cleared.
@@ -191,9 +207,62 @@ public:
      */
     virtual bool load(const QString &filename, bool &encodingErrors, bool &tooLongLinesWrapped, int &longestLineLoaded, bool enforceTextCodec);
 
+    /**
+     * Enable progressive loading for the next load() calls.
+     * If enabled, load() returns as soon as the lines read within a short time budget are in the buffer.
+     * The remaining lines are appended in batches from the event loop, see isLoading().
+     * The out parameters of load() are only valid if the file got loaded completely, else loadingFinished() delivers them.
+     * Progressive loads decode the file on the calling thread, without them large files are decoded on multiple threads.
+     * @param progressive load progressively?
+     */
+    void setProgressiveLoading(bool progressive)
+    {
+        m_progressiveLoading = progressive;
+    }
+
+    /**
+     * Enable paged loading for the next load() calls.
+     * If enabled, load() only scans large UTF-8 or Latin-1 files for line ends and remembers where the text
+     * of each block is in the file. The lines of a block are read on first access and dropped again if too many
+     * blocks are in memory, only modified blocks stay. Files with other line ends than line feeds, too long lines
+     * or encoding errors are loaded normally.
+     * The file must not change while it is paged, the buffer should be read-only and can't be saved, see isPaged().
+     * @param paged load paged?
+     */
+    void setPagedLoading(bool paged)
+    {
+        m_pagedLoading = paged;
+    }
+
+    /**
+     * Are lines of this buffer read from the loaded file on demand?
+     * @return buffer is paged?
+     */
+    bool isPaged() const
+    {
+        return m_paged != nullptr;
+    }
+
+    /**
+     * Is a progressive load still appending lines to this buffer?
+     * @return loading in progress?
+     */
+    bool isLoading() const
+    {
+        return m_loading != nullptr;
+    }
+
+    /**
+     * Complete a running progressive load, will read all remaining lines at once.
+     * Does nothing if no load is running.
+     */
+    void finishLoading();
+
     /**
      * Save the current buffer content to the given file.
      * Before calling this, setTextCodec and setFallbackTextCodec must have been used to set codec!
+     * On success, digest() is the checksum of the written file if it could be computed while writing, else empty.
+     * Paged buffers can't be saved, see isPaged().
      * @param filename file to save
      * @return success
      * Virtual, can be overwritten.
@@ -234,6 +303,43 @@ public:
      */
     void setLineMetaData(int line, const TextLine &textLine);
 
+    /**
+     * Access a line to change its non text attributes in place, e.g. for highlighting.
+     * Unlike line() + setLineMetaData() this copies neither the text nor the attributes.
+     * The text must not be changed via the returned reference, it is only valid until the buffer is modified.
+     * @param line line number to access
+     * @return text line stored in the buffer
+     */
+    TextLine &lineForMetaData(int line);
+
+    /**
+     * Access a line to change its non text attributes in place, like lineForMetaData(), but a paged block stays paged.
+     * The changes are lost once the lines of the block are dropped from memory, mark them via setPagedMetaDataTag().
+     * The reference is only valid until the next line of another block is accessed.
+     * @param line line number to access
+     * @return text line stored in the buffer
+     */
+    TextLine &lineForPagedMetaData(int line);
+
+    /**
+     * Mark lines to have meta data of the kind @p tag, e.g. highlighting of some generation.
+     * The mark is dropped together with the lines of a paged block, see lineForPagedMetaData().
+     * Only one range of lines per block is remembered, the last marked one, joined with the ones before if they touch.
+     * Lines of paged blocks that are not in memory are not marked.
+     * @param startLine first line with such meta data
+     * @param endLine last line with such meta data
+     * @param tag kind of the meta data, not 0
+     */
+    void setPagedMetaDataTag(int startLine, int endLine, quint64 tag);
+
+    /**
+     * Has @p line still the meta data marked via setPagedMetaDataTag()?
+     * @param line line to check
+     * @param tag kind of the meta data
+     * @return meta data there?
+     */
+    bool hasPagedMetaDataTag(int line, quint64 tag) const;
+
     /**
      * Retrieve length for @p line
      * @param line wanted line number
@@ -397,12 +503,32 @@ Q_SIGNALS:
      */
     void loaded(const QString &filename, bool encodingErrors);
 
+    /**
+     * A progressive load appended a batch of lines to the buffer.
+     */
+    void loadingProgress();
+
+    /**
+     * A progressive load finished after load() did return, all lines are in the buffer now.
+     * Emitted after loaded().
+     * @param encodingErrors were there problems occurred while decoding the file?
+     * @param tooLongLinesWrapped were too long lines found and wrapped?
+     * @param longestLineLoaded the longest line in the file (before wrapping)
+     */
+    void loadingFinished(bool encodingErrors, bool tooLongLinesWrapped, int longestLineLoaded);
+
     /**
      * Buffer saved successfully a file
      * @param filename file which was saved
      */
     void saved(const QString &filename);
 
+    /**
+     * The file of a paged buffer got changed on disk, its lines not in memory can't be read any more.
+     * Emitted once, the next time the lines of such a block are needed.
+     */
+    void pagedFileChanged();
+
 private:
     /**
      * Save result which indicates an abstract reason why the operation has
@@ -414,6 +540,46 @@ private:
         Success
     };
 
+    /**
+     * State of a running load, kept alive between the batches of a progressive load
+     */
+    struct LoadingState;
+
+    /**
+     * File of a paged buffer and the blocks of it that are in memory, see setPagedLoading()
+     */
+    struct PagedFile;
+
+    /**
+     * Result of one continueLoading() call
+     */
+    enum class LoadResult {
+        Failed = 0,
+        Pending,
+        Finished
+    };
+
+    /**
+     * Run the loading rounds of m_loading, starting where the last call stopped.
+     * For progressive loading this stops after a time budget with LoadResult::Pending.
+     * @return loading result
+     */
+    KTEXTEDITOR_NO_EXPORT
+    LoadResult continueLoading();
+
+    /**
+     * Read the next batch of a progressive load, triggered by m_loadingTimer.
+     */
+    KTEXTEDITOR_NO_EXPORT
+    void loadNextBatch();
+
+    /**
+     * Remove all blocks, move all cursors not belonging to ranges to the start of a new empty block.
+     * Ranges get invalidated. Afterwards the buffer has one empty line.
+     */
+    KTEXTEDITOR_NO_EXPORT
+    void resetBlocks();
+
     /**
      * Find block containing given line.
      * @param line we want to find block for this line
@@ -423,11 +589,51 @@ private:
     // exported for movingrange_test
 
     /**
-     * Fix start lines of all blocks after the given one
+     * Fix start lines of all blocks after the given one.
+     * This won't touch the start lines directly, they are marked as outdated
+     * and lazily recomputed on the next access, see ensureStartLinesValid.
+     * That keeps bulk line inserts near the start of large files linear.
      * @param startBlock index of block from which we start to fix
      */
     KTEXTEDITOR_NO_EXPORT
-    void fixStartLines(int startBlock, int value);
+    void fixStartLines(int startBlock);
+
+    /**
+     * Recompute outdated start lines up to and including the given block.
+     * @param index index of block that needs a valid start line
+     */
+    KTEXTEDITOR_NO_EXPORT
+    void ensureStartLinesValid(int index) const;
+
+    /**
+     * Start line of the given block, will fix outdated start lines if needed.
+     * @param index index of block
+     * @return start line of the block
+     */
+    int startLineOfBlock(int index) const
+    {
+        if (index >= m_startLinesDirtyFrom) {
+            ensureStartLinesValid(index);
+        }
+        return m_startLines[index];
+    }
+
+    /**
+     * Mark the cached character offsets of all blocks starting with the given one as outdated.
+     * Must be called whenever m_blockSizes changes or blocks are inserted/removed.
+     * @param startBlock index of first block with changed offset
+     */
+    void invalidateBlockOffsets(int startBlock)
+    {
+        m_blockOffsetsDirtyFrom = std::min(m_blockOffsetsDirtyFrom, startBlock);
+    }
+
+    /**
+     * Recompute outdated cached character offsets up to and including the given block.
+     * @param index index of block that needs a valid offset
+     */
+    KTEXTEDITOR_NO_EXPORT
+    void ensureBlockOffsetsValid(int index) const;
 
     /**
      * Balance the given block. Look if it is too small or too large.
@@ -452,28 +658,93 @@ private:
     KTEXTEDITOR_NO_EXPORT
     void markModifiedLinesAsSaved();
 
+    /**
+     * Load the already opened file using multiple threads, see TextLoader::canReadParallel.
+     * The file is decoded and split into blocks per chunk on a thread pool, the digest is computed in parallel.
+     * The buffer must be empty, with only the initial block left.
+     * @param file opened file loader
+     * @param tooLongLinesWrapped were too long lines found and wrapped?
+     * @param longestLineLoaded the longest line in the file (before wrapping)
+     * @return were there encoding errors?
+     */
+    KTEXTEDITOR_NO_EXPORT
+    bool loadParallel(TextLoader &file, bool &tooLongLinesWrapped, int &longestLineLoaded);
+
+    /**
+     * Scan the already opened file for line ends and create paged blocks for it, see setPagedLoading().
+     * The line ends are searched in parallel per chunk of the file, the digest is computed in parallel.
+     * The buffer must be empty, with only the initial block left.
+     * @param filename file to page
+     * @param file opened file loader
+     * @param longestLineLoaded the longest line in the file
+     * @return could the file be paged? if not, the buffer is unchanged
+     */
+    KTEXTEDITOR_NO_EXPORT
+    bool loadPaged(const QString &filename, TextLoader &file, int &longestLineLoaded);
+
+    /**
+     * Read the lines of the given paged block if they are not in memory, drops the least recently used block
+     * if the cache is full. Used by const accessors of the block, only the cache changes.
+     * The lines are read with a blocking read, paged files are always local, see TextLoader::canReadParallel, and a block has only a few lines.
+     * If the file got changed meanwhile, the lines are left empty and pagedFileChanged() is emitted.
+     * @param blockIndex index of the paged block
+     */
+    KTEXTEDITOR_NO_EXPORT
+    void pageInBlock(int blockIndex);
+
+    /**
+     * Keep the lines of the given paged block in memory, it is no longer paged afterwards.
+     * @param block paged block
+     */
+    KTEXTEDITOR_NO_EXPORT
+    void pinPagedBlock(TextBlock *block);
+
     /**
      * Save the current buffer content to the given already opened device
      *
      * @param filename path name for display/debugging purposes
      * @param saveFile open device to write the buffer to
+     * @param digest git compatible sha1 digest of the written bytes, empty if it can't be computed while writing
+     */
+    KTEXTEDITOR_NO_EXPORT
+    bool saveBuffer(const QString &filename, KCompressionDevice &saveFile, QByteArray &digest);
+
+    /**
+     * Encode the buffer content on a thread pool in chunks of complete blocks and write them in order.
+     * Only valid for stateless codecs like UTF-8 or Latin-1, a BOM must be written by begin.
+     * The encoded size of all chunks is counted on the thread pool first and passed to begin before anything is written.
+     * @param write writes the given bytes to the file, returns success
+     * @param eol end of line string
+     * @param begin gets the number of bytes that will be written, returns success
+     * @return success
+     */
+    KTEXTEDITOR_NO_EXPORT
+    bool saveBufferParallel(const std::function<bool(QByteArrayView)> &write, const QString &eol, const std::function<bool(qint64)> &begin);
+
+    /**
+     * Number of bytes the given blocks will have once encoded in the current codec, including their line ends.
+     * Only valid for UTF-8 or Latin-1, paged blocks must be in memory.
+     * @param firstBlock first block to count
+     * @param endBlock block behind the last one to count
+     * @param eol end of line string
+     * @return size in bytes
      */
     KTEXTEDITOR_NO_EXPORT
-    bool saveBuffer(const QString &filename, KCompressionDevice &saveFile);
+    qint64 encodedSize(size_t firstBlock, size_t endBlock, const QString &eol) const;
 
     /**
      * Attempt to save the buffer content in the given filename location using
      * current privileges.
      */
     KTEXTEDITOR_NO_EXPORT
-    SaveResult saveBufferUnprivileged(const QString &filename);
+    SaveResult saveBufferUnprivileged(const QString &filename, QByteArray &digest);
 
     /**
      * Attempt to save the buffer content in the given filename location using
      * escalated privileges.
      */
     KTEXTEDITOR_NO_EXPORT
-    bool saveBufferEscalated(const QString &filename);
+    bool saveBufferEscalated(const QString &filename, QByteArray &digest);
 
 public:
     /**
@@ -520,6 +791,76 @@ public:
     KTEXTEDITOR_NO_EXPORT void removeMultilineRange(TextRange *range);
     bool hasMultlineRange(KTextEditor::MovingRange *range) const;
 
+    /**
+     * Queue/Unqueue the feedback notification of a range changed during the running editing transaction.
+     * Queued ranges are notified once after the last transaction is finished.
+     */
+    KTEXTEDITOR_NO_EXPORT void addPendingFeedbackNotification(TextRange *range);
+    KTEXTEDITOR_NO_EXPORT void removePendingFeedbackNotification(TextRange *range);
+
+private:
+    /**
+     * Mark the interval index of the multiline ranges as outdated.
+     * Must be called whenever the lines of these ranges might have changed.
+     */
+    void invalidateMultilineRangesIndex()
+    {
+        m_multilineRangesIndexValid = false;
+    }
+
+    /**
+     * Build the interval index of the multiline ranges, used by rangesForLine().
+     */
+    KTEXTEDITOR_NO_EXPORT void updateMultilineRangesIndex() const;
+
+    /**
+     * Append the multiline ranges intersecting the given line found in the subtree [begin, end) of the interval index.
+     */
+    KTEXTEDITOR_NO_EXPORT void multilineRangesForLine(size_t begin,
+                                                      size_t end,
+                                                      int line,
+                                                      KTextEditor::View *view,
+                                                      bool rangesWithAttributeOnly,
+                                                      QList<TextRange *> &outRanges) const;
+
+    //
+    // memory accounting
+    //
+public:
+    /**
+     * Memory used by the buffer, in bytes.
+     * Computed from the sizes of the containers, without the allocator overhead.
+     */
+    struct MemoryUsage {
+        /**
+         * text of the lines in memory and the blocks holding them
+         */
+        qint64 text = 0;
+
+        /**
+         * highlighting attributes of the lines
+         */
+        qint64 attributes = 0;
+
+        /**
+         * moving cursors and ranges, including their indexes
+         */
+        qint64 cursors = 0;
+
+        /**
+         * editing history, see TextHistory
+         */
+        qint64 history = 0;
+    };
+
+    /**
+     * Compute the memory used by the buffer.
+     * Walks the blocks, only the lines of blocks changed since the last call are counted again.
+     * Attribute lists shared among lines are not included, see TextLine::shareAttributes.
+     * @return memory used
+     */
+    MemoryUsage memoryUsage() const;
+
     //
     // checksum handling
     //
@@ -554,8 +895,14 @@ private:
 
     /**
      * List of starting lines of the blocks in m_blocks
+     * Entries starting at m_startLinesDirtyFrom are outdated, use startLineOfBlock to access them.
      */
-    std::vector<int> m_startLines;
+    mutable std::vector<int> m_startLines;
+
+    /**
+     * Index of first block with outdated start line, std::numeric_limits<int>::max() if all are valid
+     */
+    mutable int m_startLinesDirtyFrom = std::numeric_limits<int>::max();
 
     /**
      * List of blocks which contain the lines of this buffer
@@ -567,6 +914,17 @@ private:
      */
     std::vector<int> m_blockSizes;
 
+    /**
+     * Cached prefix sums of m_blockSizes, the character offset of each block in m_blocks
+     * Entries starting at m_blockOffsetsDirtyFrom are outdated, see ensureBlockOffsetsValid.
+     */
+    mutable std::vector<int> m_blockOffsets;
+
+    /**
+     * Index of first block with outdated offset, std::numeric_limits<int>::max() if all are valid
+     */
+    mutable int m_blockOffsetsDirtyFrom = 0;
+
     /**
      * Number of lines in buffer
      */
@@ -607,6 +965,35 @@ private:
      */
     std::vector<TextRange *> m_multilineRanges;
 
+    /**
+     * Interval index over m_multilineRanges: sorted by start line, each entry stores the maximal
+     * end line of the subtree it is the root of in an implicit balanced binary search tree.
+     * Built on demand, see m_multilineRangesIndexValid.
+     */
+    struct MultilineRangesIndexEntry {
+        int startLine;
+        int endLine;
+        int maxEndLine;
+        TextRange *range;
+    };
+    mutable std::vector<MultilineRangesIndexEntry> m_multilineRangesIndex;
+
+    /**
+     * Is the interval index of the multiline ranges up-to-date?
+     */
+    mutable bool m_multilineRangesIndexValid = false;
+
+    /**
+     * Number of ranges of this buffer, for memoryUsage()
+     */
+    qint64 m_rangeCount = 0;
+
+    /**
+     * Ranges with feedback changed by the running editing transaction, notified in finishEditing().
+     * Slots of ranges deleted meanwhile are nullptr, see removePendingFeedbackNotification().
+     */
+    std::vector<TextRange *> m_pendingFeedbackNotifications;
+
     /**
      * Encoding prober type to use
      */
@@ -648,6 +1035,36 @@ private:
      */
     bool m_alwaysUseKAuthForSave;
 
+    /**
+     * Should load() store Latin-1 lines in compact form?
+     */
+    bool m_compactLineStorage = false;
+
+    /**
+     * Should load() return early and append the remaining lines from the event loop?
+     */
+    bool m_progressiveLoading = false;
+
+    /**
+     * Should load() page large files?
+     */
+    bool m_pagedLoading = false;
+
+    /**
+     * File the paged blocks are read from, nullptr if the buffer is not paged
+     */
+    std::unique_ptr<PagedFile> m_paged;
+
+    /**
+     * State of the running progressive load, nullptr if none
+     */
+    std::unique_ptr<LoadingState> m_loading;
+
+    /**
+     * Triggers the next batch of a progressive load
+     */
+    QTimer m_loadingTimer;
+
     /**
      * For copying QBuffer -> QTemporaryFile while saving document in privileged mode
      */
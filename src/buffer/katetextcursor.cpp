@@ -51,6 +51,12 @@ void TextCursor::setPosition(const TextCursor &position)
     m_block = position.m_block;
     if (m_block) {
         m_block->insertCursor(this);
+        m_block->invalidateRangeIndex();
+    }
+
+    // lookup structures for ranges need an update
+    if (m_range) {
+        m_buffer->invalidateMultilineRangesIndex();
     }
 }
 
@@ -72,6 +78,11 @@ void TextCursor::setPosition(KTextEditor::Cursor position, bool init)
         // else: we need to handle the change in a more complex way, new or old column are not valid!
     }
 
+    // the line changes, lookup structures for ranges need an update
+    if (m_range) {
+        m_buffer->invalidateMultilineRangesIndex();
+    }
+
     // first: validate the line and column, else invalid
     if (!position.isValid() || position.line() >= m_buffer->lines()) {
         if (m_block) {
@@ -93,6 +104,8 @@ void TextCursor::setPosition(KTextEditor::Cursor position, bool init)
         Q_ASSERT(m_block);
         m_block->insertCursor(this);
         startLine = m_block->startLine();
+    } else {
+        m_block->invalidateRangeIndex();
     }
 
     // else: valid cursor
@@ -437,6 +437,13 @@ void TextFolding::debugPrint(const QString &title) const
     printf("%s\n    %s\n", qPrintable(title), qPrintable(debugDump()));
 }
 
+qint64 TextFolding::memoryUsage() const
+{
+    // the folded ranges are part of the tree, only their vector is extra
+    return memoryUsage(m_foldingRanges) + m_foldedFoldingRanges.capacity() * sizeof(FoldingRange *)
+        + m_idToFoldingRange.capacity() * (sizeof(qint64) + sizeof(FoldingRange *));
+}
+
 void TextFolding::editEnd(int startLine, int endLine, std::function<bool(int)> isLineFoldingStart)
 {
     // search upper bound, index to item with start line higher than our one
@@ -495,6 +502,15 @@ QString TextFolding::debugDump(const TextFolding::FoldingRange::Vector &ranges,
     return dump;
 }
 
+qint64 TextFolding::memoryUsage(const TextFolding::FoldingRange::Vector &ranges)
+{
+    qint64 bytes = ranges.capacity() * sizeof(FoldingRange *);
+    for (const FoldingRange *range : ranges) {
+        bytes += sizeof(FoldingRange) + memoryUsage(range->nestedRanges);
+    }
+    return bytes;
+}
+
 bool TextFolding::insertNewFoldingRange(FoldingRange *parent, FoldingRange::Vector &existingRanges, FoldingRange *newRange)
 {
     // existing ranges are non-overlapping and sorted
@@ -181,6 +181,12 @@ public:
      */
     void debugPrint(const QString &title) const;
 
+    /**
+     * Memory used by the folding ranges, without their cursors, these are part of the buffer.
+     * @return bytes used
+     */
+    qint64 memoryUsage() const;
+
     void editEnd(int startLine, int endLine, std::function<bool(int)> isLineFoldingStart);
 
 public Q_SLOTS:
@@ -284,6 +290,14 @@ private:
     KTEXTEDITOR_NO_EXPORT
     static QString debugDump(const TextFolding::FoldingRange::Vector &ranges, bool recurse);
 
+    /**
+     * Memory used by the given ranges and their nested ranges.
+     * @param ranges ranges vector to account
+     * @return bytes used
+     */
+    KTEXTEDITOR_NO_EXPORT
+    static qint64 memoryUsage(const TextFolding::FoldingRange::Vector &ranges);
+
     /**
      * Helper to insert folding range into existing ones.
      * Might fail, if not correctly nested.
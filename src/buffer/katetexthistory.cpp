@@ -5,6 +5,7 @@
 */
 
 #include "katetexthistory.h"
+#include "katepartdebug.h"
 #include "katetextbuffer.h"
 
 namespace Kate
@@ -25,6 +26,15 @@ qint64 TextHistory::revision() const
     return m_buffer.revision();
 }
 
+qint64 TextHistory::memoryUsage() const
+{
+    qint64 bytes = m_historyEntries.capacity() * sizeof(Entry);
+    for (const CheckpointLevel &level : m_checkpoints) {
+        bytes += level.checkpoints.capacity() * sizeof(Checkpoint);
+    }
+    return bytes;
+}
+
 void TextHistory::clear()
 {
     // reset last saved revision
@@ -36,6 +46,11 @@ void TextHistory::clear()
 
     // first entry will again belong to the current revision
     m_firstHistoryEntryRevision = revision();
+
+    // no checkpoints for the old entries
+    for (auto &level : m_checkpoints) {
+        level = CheckpointLevel();
+    }
 }
 
 void TextHistory::setLastSavedRevision()
@@ -109,6 +124,93 @@ void TextHistory::addEntry(const Entry &entry)
 
     // ok, we have more than one entry or the entry is referenced, just add up new entries
     m_historyEntries.push_back(entry);
+    updateCheckpoints();
+
+    // if wanted, locked revisions must not let the history grow without bounds, drop the oldest ones, even if locked
+    if (m_maximalHistoryEntries > 0 && qint64(m_historyEntries.size()) > m_maximalHistoryEntries) {
+        const qint64 count = std::max<qint64>(1, m_maximalHistoryEntries / 4);
+        const qint64 locked = std::count_if(m_historyEntries.begin(), m_historyEntries.begin() + count, [](const Entry &entry) {
+            return entry.referenceCounter > 0;
+        });
+        if (locked > 0) {
+            qCWarning(LOG_KTE) << "Dropped" << locked << "locked revisions, the history has more than" << m_maximalHistoryEntries << "entries";
+        }
+        removeOldestEntries(count);
+    }
+}
+
+void TextHistory::removeOldestEntries(qint64 count)
+{
+    // remove stuff from history
+    m_historyEntries.erase(m_historyEntries.begin(), m_historyEntries.begin() + count);
+
+    // patch first entry revision
+    m_firstHistoryEntryRevision += count;
+
+    // drop checkpoints for removed entries, runs starting before the first entry are never used again
+    for (int i = 0; i < CheckpointLevels; ++i) {
+        CheckpointLevel &level = m_checkpoints[i];
+        const qint64 runLength = checkpointRunLength(i);
+        qint64 removed = 0;
+        while (removed < qint64(level.checkpoints.size()) && (level.firstRun + removed) * runLength < m_firstHistoryEntryRevision) {
+            ++removed;
+        }
+        level.checkpoints.erase(level.checkpoints.begin(), level.checkpoints.begin() + removed);
+        level.firstRun += removed;
+    }
+}
+
+void TextHistory::updateCheckpoints()
+{
+    // revision of the new entry, runs are complete if it is the last revision of them
+    const qint64 lastRevision = m_firstHistoryEntryRevision + qint64(m_historyEntries.size()) - 1;
+    for (int i = 0; i < CheckpointLevels; ++i) {
+        const qint64 runLength = checkpointRunLength(i);
+        const qint64 lowerRunLength = runLength / CheckpointRunLength;
+        if ((lastRevision + 1) % runLength != 0) {
+            return;
+        }
+
+        // combine the entries or the checkpoints of the level below, all must be there
+        const qint64 firstRevision = lastRevision + 1 - runLength;
+        if (firstRevision < m_firstHistoryEntryRevision) {
+            return;
+        }
+        Checkpoint checkpoint;
+        for (qint64 revision = firstRevision; revision <= lastRevision; revision += lowerRunLength) {
+            const Checkpoint *lower = (i == 0) ? nullptr : this->checkpoint(i - 1, revision, lastRevision);
+            if (i > 0 && !lower) {
+                return;
+            }
+            const Checkpoint next = lower ? *lower : m_historyEntries[revision - m_firstHistoryEntryRevision].checkpoint();
+            checkpoint = (revision == firstRevision) ? next : checkpoint.then(next);
+        }
+
+        // the checkpoints of one level cover consecutive runs
+        CheckpointLevel &level = m_checkpoints[i];
+        const qint64 run = firstRevision / runLength;
+        if (level.checkpoints.empty() || level.firstRun + qint64(level.checkpoints.size()) != run) {
+            level.checkpoints.clear();
+            level.firstRun = run;
+        }
+        level.checkpoints.push_back(checkpoint);
+    }
+}
+
+const TextHistory::Checkpoint *TextHistory::checkpoint(int level, qint64 firstRevision, qint64 lastRevision) const
+{
+    // only complete runs starting at the given revision
+    const qint64 runLength = checkpointRunLength(level);
+    if (firstRevision < 0 || firstRevision % runLength != 0 || firstRevision + runLength - 1 > lastRevision) {
+        return nullptr;
+    }
+
+    const CheckpointLevel &checkpoints = m_checkpoints[level];
+    const qint64 index = firstRevision / runLength - checkpoints.firstRun;
+    if (index < 0 || index >= qint64(checkpoints.checkpoints.size())) {
+        return nullptr;
+    }
+    return &checkpoints.checkpoints[index];
 }
 
 void TextHistory::lockRevision(qint64 revision)
@@ -127,9 +229,13 @@ void TextHistory::unlockRevision(qint64 revision)
 {
     // some invariants must hold
     Q_ASSERT(!m_historyEntries.empty());
-    Q_ASSERT(revision >= m_firstHistoryEntryRevision);
     Q_ASSERT(revision < (m_firstHistoryEntryRevision + qint64(m_historyEntries.size())));
 
+    // revision already dropped, because the history got too large
+    if (revision < m_firstHistoryEntryRevision) {
+        return;
+    }
+
     // decrement revision reference counter
     Entry &entry = m_historyEntries[revision - m_firstHistoryEntryRevision];
     Q_ASSERT(entry.referenceCounter);
@@ -150,11 +256,7 @@ void TextHistory::unlockRevision(qint64 revision)
 
         // remove unreferred from the list now
         if (unreferencedEdits > 0) {
-            // remove stuff from history
-            m_historyEntries.erase(m_historyEntries.begin(), m_historyEntries.begin() + unreferencedEdits);
-
-            // patch first entry revision
-            m_firstHistoryEntryRevision += unreferencedEdits;
+            removeOldestEntries(unreferencedEdits);
         }
     }
 }
@@ -349,6 +451,28 @@ void TextHistory::Entry::reverseTransformCursor(int &cursorLine, int &cursorColu
     }
 }
 
+TextHistory::Checkpoint TextHistory::Entry::checkpoint() const
+{
+    switch (type) {
+    // lines behind the wrapped one move down, reverse: the line behind the wrapped one is joined again
+    case WrapLine:
+        return {{line, line, 1}, {line + 1, line + 1, -1}};
+
+    // lines behind the unwrapped one move up, reverse: the line in front of the unwrapped one is split again
+    case UnwrapLine:
+        return {{line, line, -1}, {line - 1, line - 1, 1}};
+
+    // only columns in the edited line change
+    case InsertText:
+    case RemoveText:
+        return {{line, line, 0}, {line, line, 0}};
+
+    // nothing
+    default:
+        return {};
+    }
+}
+
 void TextHistory::transformCursor(int &line, int &column, KTextEditor::MovingCursor::InsertBehavior insertBehavior, qint64 fromRevision, qint64 toRevision)
 {
     // -1 special meaning for from/toRevision
@@ -365,31 +489,178 @@ void TextHistory::transformCursor(int &line, int &column, KTextEditor::MovingCur
         return;
     }
 
+    // the history of dropped revisions is gone
+    if (!isKnownRevision(fromRevision) || !isKnownRevision(toRevision)) {
+        line = -1;
+        column = -1;
+        return;
+    }
+
     // some invariants must hold
     Q_ASSERT(!m_historyEntries.empty());
     Q_ASSERT(fromRevision != toRevision);
-    Q_ASSERT(fromRevision >= m_firstHistoryEntryRevision);
-    Q_ASSERT(fromRevision < (m_firstHistoryEntryRevision + qint64(m_historyEntries.size())));
-    Q_ASSERT(toRevision >= m_firstHistoryEntryRevision);
-    Q_ASSERT(toRevision < (m_firstHistoryEntryRevision + qint64(m_historyEntries.size())));
 
     // transform cursor
     bool moveOnInsert = insertBehavior == KTextEditor::MovingCursor::MoveOnInsert;
 
     // forward or reverse transform?
+    // runs of revisions not touching the line of the cursor are skipped using the largest fitting checkpoint
     if (toRevision > fromRevision) {
-        for (int rev = fromRevision - m_firstHistoryEntryRevision + 1; rev <= (toRevision - m_firstHistoryEntryRevision); ++rev) {
-            const Entry &entry = m_historyEntries.at(rev);
+        for (qint64 rev = fromRevision + 1; rev <= toRevision;) {
+            qint64 skipped = 0;
+            for (int level = CheckpointLevels - 1; level >= 0 && !skipped; --level) {
+                const Checkpoint *checkpoint = this->checkpoint(level, rev, toRevision);
+                if (checkpoint && checkpoint->forward.canTransform(line)) {
+                    checkpoint->forward.transform(line);
+                    skipped = checkpointRunLength(level);
+                }
+            }
+            if (skipped) {
+                rev += skipped;
+                continue;
+            }
+
+            const Entry &entry = m_historyEntries.at(rev - m_firstHistoryEntryRevision);
             entry.transformCursor(line, column, moveOnInsert);
+            ++rev;
         }
     } else {
-        for (int rev = fromRevision - m_firstHistoryEntryRevision; rev >= (toRevision - m_firstHistoryEntryRevision + 1); --rev) {
-            const Entry &entry = m_historyEntries.at(rev);
+        for (qint64 rev = fromRevision; rev > toRevision;) {
+            qint64 skipped = 0;
+            for (int level = CheckpointLevels - 1; level >= 0 && !skipped; --level) {
+                const qint64 runLength = checkpointRunLength(level);
+                const Checkpoint *checkpoint = this->checkpoint(level, rev - runLength + 1, fromRevision);
+                if (checkpoint && rev - runLength >= toRevision && checkpoint->reverse.canTransform(line)) {
+                    checkpoint->reverse.transform(line);
+                    skipped = runLength;
+                }
+            }
+            if (skipped) {
+                rev -= skipped;
+                continue;
+            }
+
+            const Entry &entry = m_historyEntries.at(rev - m_firstHistoryEntryRevision);
             entry.reverseTransformCursor(line, column, moveOnInsert);
+            --rev;
         }
     }
 }
 
+void TextHistory::transformCursors(std::span<KTextEditor::Cursor> cursors,
+                                   KTextEditor::MovingCursor::InsertBehavior insertBehavior,
+                                   qint64 fromRevision,
+                                   qint64 toRevision)
+{
+    // -1 special meaning for from/toRevision
+    if (fromRevision == -1) {
+        fromRevision = revision();
+    }
+
+    if (toRevision == -1) {
+        toRevision = revision();
+    }
+
+    // shortcut, same revision or nothing to do
+    if (fromRevision == toRevision || cursors.empty()) {
+        return;
+    }
+
+    // the history of dropped revisions is gone
+    if (!isKnownRevision(fromRevision) || !isKnownRevision(toRevision)) {
+        std::fill(cursors.begin(), cursors.end(), KTextEditor::Cursor::invalid());
+        return;
+    }
+
+    // some invariants must hold
+    Q_ASSERT(!m_historyEntries.empty());
+
+    // sort the cursors, the transformations keep that order
+    std::vector<KTextEditor::Cursor> sorted(cursors.begin(), cursors.end());
+    std::vector<int> order(cursors.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = int(i);
+    }
+    std::stable_sort(order.begin(), order.end(), [&cursors](int a, int b) {
+        return cursors[a] < cursors[b];
+    });
+    for (size_t i = 0; i < order.size(); ++i) {
+        sorted[i] = cursors[order[i]];
+    }
+
+    // line moves of all cursors behind an edited line are added up in a Fenwick tree, not applied to each cursor
+    const int count = int(sorted.size());
+    std::vector<int> lineDeltas(count + 1, 0);
+    const auto addLineDelta = [&lineDeltas, count](int first, int delta) {
+        for (int i = first + 1; i <= count; i += i & -i) {
+            lineDeltas[i] += delta;
+        }
+    };
+    const auto lineOf = [&lineDeltas, &sorted](int index) {
+        int line = sorted[index].line();
+        for (int i = index + 1; i > 0; i -= i & -i) {
+            line += lineDeltas[i];
+        }
+        return line;
+    };
+    const auto firstBehindLine = [&lineOf, count](int line) {
+        int first = 0;
+        int last = count;
+        while (first < last) {
+            const int middle = first + (last - first) / 2;
+            if (lineOf(middle) <= line) {
+                first = middle + 1;
+            } else {
+                last = middle;
+            }
+        }
+        return first;
+    };
+
+    // apply one entry: cursors on the changed line are transformed one by one, the ones behind only move lines
+    const bool moveOnInsert = insertBehavior == KTextEditor::MovingCursor::MoveOnInsert;
+    const auto apply = [&](const Entry &entry, const LineShift &shift) {
+        if (shift.firstLine == std::numeric_limits<int>::max()) {
+            return;
+        }
+        const int first = firstBehindLine(shift.firstLine - 1);
+        const int behind = firstBehindLine(shift.firstLine);
+        for (int i = first; i < behind; ++i) {
+            const int oldLine = lineOf(i);
+            int line = oldLine;
+            int column = sorted[i].column();
+            if (toRevision > fromRevision) {
+                entry.transformCursor(line, column, moveOnInsert);
+            } else {
+                entry.reverseTransformCursor(line, column, moveOnInsert);
+            }
+            sorted[i].setPosition(sorted[i].line() + line - oldLine, column);
+        }
+        if (shift.lineDelta != 0 && behind < count) {
+            addLineDelta(behind, shift.lineDelta);
+        }
+    };
+
+    // forward or reverse transform?
+    if (toRevision > fromRevision) {
+        for (qint64 rev = fromRevision + 1; rev <= toRevision; ++rev) {
+            const Entry &entry = m_historyEntries.at(rev - m_firstHistoryEntryRevision);
+            apply(entry, entry.checkpoint().forward);
+        }
+    } else {
+        for (qint64 rev = fromRevision; rev > toRevision; --rev) {
+            const Entry &entry = m_historyEntries.at(rev - m_firstHistoryEntryRevision);
+            apply(entry, entry.checkpoint().reverse);
+        }
+    }
+
+    // copy the results back in the original order
+    for (int i = 0; i < count; ++i) {
+        sorted[i].setLine(lineOf(i));
+        cursors[order[i]] = sorted[i];
+    }
+}
+
 void TextHistory::transformRange(KTextEditor::Range &range,
                                  KTextEditor::MovingRange::InsertBehaviors insertBehaviors,
                                  KTextEditor::MovingRange::EmptyBehavior emptyBehavior,
@@ -417,13 +688,15 @@ void TextHistory::transformRange(KTextEditor::Range &range,
         return;
     }
 
+    // the history of dropped revisions is gone
+    if (!isKnownRevision(fromRevision) || !isKnownRevision(toRevision)) {
+        range = KTextEditor::Range::invalid();
+        return;
+    }
+
     // some invariants must hold
     Q_ASSERT(!m_historyEntries.empty());
     Q_ASSERT(fromRevision != toRevision);
-    Q_ASSERT(fromRevision >= m_firstHistoryEntryRevision);
-    Q_ASSERT(fromRevision < (m_firstHistoryEntryRevision + qint64(m_historyEntries.size())));
-    Q_ASSERT(toRevision >= m_firstHistoryEntryRevision);
-    Q_ASSERT(toRevision < (m_firstHistoryEntryRevision + qint64(m_historyEntries.size())));
 
     // transform cursors
 
@@ -437,9 +710,25 @@ void TextHistory::transformRange(KTextEditor::Range &range,
     bool moveOnInsertEnd = (insertBehaviors & KTextEditor::MovingRange::ExpandRight);
 
     // forward or reverse transform?
+    // runs of revisions not touching the lines of both cursors are skipped using the largest fitting checkpoint,
+    // the range can't become empty during such a run
     if (toRevision > fromRevision) {
-        for (int rev = fromRevision - m_firstHistoryEntryRevision + 1; rev <= (toRevision - m_firstHistoryEntryRevision); ++rev) {
-            const Entry &entry = m_historyEntries.at(rev);
+        for (qint64 rev = fromRevision + 1; rev <= toRevision; ++rev) {
+            bool skipped = false;
+            for (int level = CheckpointLevels - 1; level >= 0 && !skipped; --level) {
+                const Checkpoint *checkpoint = this->checkpoint(level, rev, toRevision);
+                if (checkpoint && checkpoint->forward.canTransform(startLine) && checkpoint->forward.canTransform(endLine)) {
+                    checkpoint->forward.transform(startLine);
+                    checkpoint->forward.transform(endLine);
+                    rev += checkpointRunLength(level) - 1;
+                    skipped = true;
+                }
+            }
+            if (skipped) {
+                continue;
+            }
+
+            const Entry &entry = m_historyEntries.at(rev - m_firstHistoryEntryRevision);
 
             entry.transformCursor(startLine, startColumn, moveOnInsertStart);
 
@@ -458,8 +747,24 @@ void TextHistory::transformRange(KTextEditor::Range &range,
             }
         }
     } else {
-        for (int rev = fromRevision - m_firstHistoryEntryRevision; rev >= (toRevision - m_firstHistoryEntryRevision + 1); --rev) {
-            const Entry &entry = m_historyEntries.at(rev);
+        for (qint64 rev = fromRevision; rev > toRevision; --rev) {
+            bool skipped = false;
+            for (int level = CheckpointLevels - 1; level >= 0 && !skipped; --level) {
+                const qint64 runLength = checkpointRunLength(level);
+                const Checkpoint *checkpoint = this->checkpoint(level, rev - runLength + 1, fromRevision);
+                if (checkpoint && rev - runLength >= toRevision && checkpoint->reverse.canTransform(startLine)
+                    && checkpoint->reverse.canTransform(endLine)) {
+                    checkpoint->reverse.transform(startLine);
+                    checkpoint->reverse.transform(endLine);
+                    rev -= runLength - 1;
+                    skipped = true;
+                }
+            }
+            if (skipped) {
+                continue;
+            }
+
+            const Entry &entry = m_historyEntries.at(rev - m_firstHistoryEntryRevision);
 
             entry.reverseTransformCursor(startLine, startColumn, moveOnInsertStart);
 
@@ -7,6 +7,9 @@
 #ifndef KATE_TEXTHISTORY_H
 #define KATE_TEXTHISTORY_H
 
+#include <algorithm>
+#include <limits>
+#include <span>
 #include <vector>
 
 #include <ktexteditor/movingcursor.h>
@@ -44,16 +47,35 @@ public:
     /**
      * Lock a revision, this will keep it around until released again.
      * But all revisions will always be cleared on buffer clear() (and therefor load())
+     * and, only if enabled by setMaximalHistoryEntries(), once the history grows too large.
+     * Transforms from or to dropped revisions give invalid cursors and ranges.
      * @param revision revision to lock
      */
     void lockRevision(qint64 revision);
 
+    /**
+     * Bound the history, even if revisions stay locked.
+     * Once there are more entries, the oldest quarter of them is dropped, locked revisions in there, too.
+     * Dropping locked revisions is logged as warning.
+     * @param entries maximal number of history entries, 0 for no bound, the default
+     */
+    void setMaximalHistoryEntries(qint64 entries)
+    {
+        m_maximalHistoryEntries = entries;
+    }
+
     /**
      * Release a revision.
      * @param revision revision to release
      */
     void unlockRevision(qint64 revision);
 
+    /**
+     * Memory used by the history entries and their checkpoints.
+     * @return bytes used
+     */
+    qint64 memoryUsage() const;
+
     /**
      * Transform a cursor from one revision to an other.
      * @param line line number of the cursor to transform
@@ -64,6 +86,20 @@ public:
      */
     void transformCursor(int &line, int &column, KTextEditor::MovingCursor::InsertBehavior insertBehavior, qint64 fromRevision, qint64 toRevision = -1);
 
+    /**
+     * Transform many cursors from one revision to an other.
+     * Gives the same results as transformCursor() for each cursor, but looks at each history entry only once
+     * and only touches the cursors on the line changed by it.
+     * @param cursors cursors to transform
+     * @param insertBehavior behavior of the cursors on insert of text at their position
+     * @param fromRevision from this revision we want to transform
+     * @param toRevision to this revision we want to transform, default of -1 is current revision
+     */
+    void transformCursors(std::span<KTextEditor::Cursor> cursors,
+                          KTextEditor::MovingCursor::InsertBehavior insertBehavior,
+                          qint64 fromRevision,
+                          qint64 toRevision = -1);
+
     /**
      * Transform a range from one revision to an other.
      * @param range range to transform
@@ -79,6 +115,104 @@ public:
                         qint64 toRevision = -1);
 
 private:
+    /**
+     * Effect of one or more history entries on the line of cursors, in one direction.
+     * Cursors on lines before firstLine are not changed at all,
+     * cursors on lines behind lastLine only move by lineDelta lines, columns stay the same.
+     * Cursors in between need the single entries for their transformation.
+     */
+    class LineShift
+    {
+    public:
+        /**
+         * Can the given line be transformed without looking at the single entries?
+         * @param line line number of the cursor to transform
+         */
+        bool canTransform(int line) const
+        {
+            return line < firstLine || line > lastLine;
+        }
+
+        /**
+         * transform line, only allowed if canTransform() is true
+         * @param line line number of the cursor to transform
+         */
+        void transform(int &line) const
+        {
+            if (line >= firstLine) {
+                line += lineDelta;
+            }
+        }
+
+        /**
+         * Combine with the shift applied after this one.
+         * @param next shift applied to the result of this one
+         */
+        LineShift then(const LineShift &next) const
+        {
+            return {std::min(firstLine, next.firstLine), std::max(lastLine, next.lastLine - lineDelta), lineDelta + next.lineDelta};
+        }
+
+        /**
+         * first line changed
+         */
+        int firstLine = std::numeric_limits<int>::max();
+
+        /**
+         * last line changed in other ways than a line shift
+         */
+        int lastLine = -1;
+
+        /**
+         * lines added or removed
+         */
+        int lineDelta = 0;
+    };
+
+    /**
+     * Summary of a run of history entries, used to transform cursors over many revisions at once.
+     */
+    class Checkpoint
+    {
+    public:
+        /**
+         * Combine with the checkpoint for the run of entries following this one.
+         * @param next checkpoint for the following entries
+         */
+        Checkpoint then(const Checkpoint &next) const
+        {
+            return {forward.then(next.forward), next.reverse.then(reverse)};
+        }
+
+        /**
+         * shift for transformCursor, applying the entries from first to last
+         */
+        LineShift forward;
+
+        /**
+         * shift for reverseTransformCursor, applying the entries from last to first
+         */
+        LineShift reverse;
+    };
+
+    /**
+     * Checkpoints of one size, for consecutive runs of revisions.
+     * The checkpoint with index i covers the revisions [(firstRun + i) * runLength, (firstRun + i + 1) * runLength).
+     */
+    class CheckpointLevel
+    {
+    public:
+        /**
+         * number of the run of the first checkpoint
+         */
+        qint64 firstRun = 0;
+
+        /**
+         * checkpoints for consecutive runs
+         */
+        std::vector<Checkpoint> checkpoints;
+    };
+
     /**
      * Class representing one entry in the editing history.
      */
@@ -101,6 +235,12 @@ private:
          */
         void reverseTransformCursor(int &line, int &column, bool moveOnInsert) const;
 
+        /**
+         * checkpoint for just this history entry
+         * @return effect of this entry on the line of cursors
+         */
+        Checkpoint checkpoint() const;
+
         /**
          * Types of entries, matching editing primitives of buffer and placeholder
          */
@@ -214,6 +354,54 @@ private:
 
     void addEntry(const Entry &entry);
 
+    /**
+     * Remove the oldest entries and the checkpoints covering them.
+     * @param count number of entries to remove
+     */
+
+    void removeOldestEntries(qint64 count);
+
+    /**
+     * Is the given revision still in the history?
+     * Revisions in front of the first entry got dropped, see setMaximalHistoryEntries().
+     * @param revision revision to check
+     */
+
+    bool isKnownRevision(qint64 revision) const
+    {
+        return revision >= m_firstHistoryEntryRevision && revision < m_firstHistoryEntryRevision + qint64(m_historyEntries.size());
+    }
+
+    /**
+     * Add checkpoints for the runs of revisions completed by the last added entry.
+     */
+
+    void updateCheckpoints();
+
+    /**
+     * Checkpoint covering the run of revisions starting at the given revision, not extending behind lastRevision.
+     * @param level level of the checkpoint, the run covers CheckpointRunLength^(level + 1) revisions
+     * @param firstRevision first revision of the run
+     * @param lastRevision last revision the run might include
+     * @return checkpoint or nullptr if there is none
+     */
+
+    const Checkpoint *checkpoint(int level, qint64 firstRevision, qint64 lastRevision) const;
+
+    /**
+     * Number of revisions covered by one checkpoint of the given level.
+     * @param level level of the checkpoint
+     */
+
+    static qint64 checkpointRunLength(int level)
+    {
+        qint64 runLength = CheckpointRunLength;
+        for (int i = 0; i < level; ++i) {
+            runLength *= CheckpointRunLength;
+        }
+        return runLength;
+    }
+
 private:
     /**
      * TextBuffer this history belongs to
@@ -235,6 +423,26 @@ private:
      * offset for the first entry in m_history, to which revision it really belongs?
      */
     qint64 m_firstHistoryEntryRevision;
+
+    /**
+     * Maximal number of history entries, 0 if the history is not bounded, see setMaximalHistoryEntries().
+     */
+    qint64 m_maximalHistoryEntries = 0;
+
+    /**
+     * Entries summarized per checkpoint at the lowest level, each level above combines this many checkpoints of the level below.
+     */
+    static constexpr qint64 CheckpointRunLength = 64;
+
+    /**
+     * Number of checkpoint levels, the highest level covers 64^4 = 16.7M revisions per checkpoint.
+     */
+    static constexpr int CheckpointLevels = 4;
+
+    /**
+     * Checkpoints per level, allow to transform cursors not close to the edited lines in O(log N) for N revisions.
+     */
+    CheckpointLevel m_checkpoints[CheckpointLevels];
 };
 
 }
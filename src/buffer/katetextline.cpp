@@ -187,6 +187,27 @@ void TextLine::addAttribute(const Attribute &attribute)
     m_attributesList.push_back(attribute);
 }
 
+void TextLine::shareAttributes(QSet<QList<Attribute>> &sharedAttributes, qsizetype maximalSize)
+{
+    // no storage to share
+    if (m_attributesList.isEmpty()) {
+        return;
+    }
+
+    // equal lines, e.g. repeated log lines, use the same storage
+    const auto it = sharedAttributes.constFind(m_attributesList);
+    if (it != sharedAttributes.cend()) {
+        m_attributesList = *it;
+        return;
+    }
+
+    // the first line with these attributes provides the storage for the following ones
+    if (sharedAttributes.size() < maximalSize) {
+        m_attributesList.squeeze();
+        sharedAttributes.insert(m_attributesList);
+    }
+}
+
 int TextLine::attribute(int pos) const
 {
     const auto found = std::upper_bound(m_attributesList.cbegin(), m_attributesList.cend(), pos, [](const int &p, const Attribute &x) {
@@ -11,7 +11,9 @@
 
 #include <KSyntaxHighlighting/State>
 
+#include <QHashFunctions>
 #include <QList>
+#include <QSet>
 #include <QString>
 
 namespace Kate
@@ -56,6 +58,19 @@ public:
          * attribute value (to encode type of this range)
          */
         int attributeValue;
+
+        /**
+         * Equal attributes, see TextLine::shareAttributes
+         */
+        friend bool operator==(const Attribute &a, const Attribute &b)
+        {
+            return a.offset == b.offset && a.length == b.length && a.attributeValue == b.attributeValue;
+        }
+
+        friend size_t qHash(const Attribute &attribute, size_t seed = 0) noexcept
+        {
+            return qHashMulti(seed, attribute.offset, attribute.length, attribute.attributeValue);
+        }
     };
 
     /**
@@ -337,6 +352,28 @@ public:
         return m_attributesList;
     }
 
+    /**
+     * Share the storage of the attributes with other lines.
+     * If @p sharedAttributes contains a list equal to the attributes of this line, that one is used,
+     * else a compact copy of the attributes is added, as long as @p sharedAttributes is smaller than @p maximalSize.
+     * @param sharedAttributes attribute lists shared among lines
+     * @param maximalSize maximal number of shared attribute lists
+     */
+    void shareAttributes(QSet<QList<Attribute>> &sharedAttributes, qsizetype maximalSize);
+
+    /**
+     * Take over the highlighting of an other line with the same text, e.g. computed in the background.
+     * The attributes, highlighting state and folding flags are moved, text and other flags are kept.
+     * @param other line to take the highlighting from
+     */
+    void takeHighlighting(TextLine &other)
+    {
+        constexpr unsigned int foldingFlags = flagFoldingStartAttribute | flagFoldingEndAttribute;
+        m_attributesList = std::move(other.m_attributesList);
+        m_highlightingState = other.m_highlightingState;
+        m_flags = (m_flags & ~foldingFlags) | (other.m_flags & foldingFlags);
+    }
+
     /**
      * Gets the attribute at the given position
      * use KRenderer::attributes  to get the KTextAttribute for this.
@@ -346,6 +383,15 @@ public:
      */
     int attribute(int pos) const;
 
+    /**
+     * Does this line carry any data beside its text, like attributes, highlighting state or flags?
+     * @return line has meta data?
+     */
+    bool hasMetaData() const
+    {
+        return m_flags != 0 || !m_attributesList.isEmpty() || m_highlightingState != KSyntaxHighlighting::State();
+    }
+
     /**
      * set auto-wrapped property
      * @param wrapped line was wrapped?
@@ -7,6 +7,9 @@
 #ifndef KATE_TEXTLOADER_H
 #define KATE_TEXTLOADER_H
 
+#include <algorithm>
+#include <cstring>
+#include <limits>
 #include <memory>
 
 #include <QCryptographicHash>
@@ -17,6 +20,11 @@
 
 #include <KCompressionDevice>
 #include <KEncodingProber>
+#include <KFileSystemType>
+
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#endif
 
 #include "katetextbuffer.h"
 
@@ -29,6 +37,21 @@ namespace Kate
  */
 static const qint64 KATE_FILE_LOADER_BS = 256 * 1024;
 
+/**
+ * size of the file prefix used to sniff the encoding before doing a full loading round
+ */
+static const qint64 KATE_FILE_LOADER_SNIFF_SIZE = 4 * KATE_FILE_LOADER_BS;
+
+/**
+ * files larger than this are decoded in parallel if possible, see TextLoader::canReadParallel
+ */
+static const qint64 KATE_FILE_LOADER_PARALLEL_SIZE = 32 * 1024 * 1024;
+
+/**
+ * size of the chunks for parallel decoding, chunks are extended to the next line feed
+ */
+static const qint64 KATE_FILE_LOADER_PARALLEL_CHUNK_SIZE = 4 * 1024 * 1024;
+
 /**
  * File Loader, will handle reading of files + detecting encoding
  */
@@ -48,13 +71,13 @@ public:
         , m_position(0)
         , m_lastLineStart(0)
         , m_eol(TextBuffer::eolUnknown) // no eol type detected atm
-        , m_buffer(KATE_FILE_LOADER_BS, 0)
         , m_digest(QCryptographicHash::Sha1)
         , m_bomFound(false)
         , m_firstRead(true)
         , m_proberType(proberType)
         , m_fileSize(0)
         , m_lineLengthLimit(lineLengthLimit)
+        , m_filename(filename)
     {
         // try to get mimetype for on the fly decompression, don't rely on filename!
         QFile testMime(filename);
@@ -64,13 +87,8 @@ public:
         m_mimeType = QMimeDatabase().mimeTypeForFileNameAndData(filename, &testMime).name();
 
         // construct filter device, if needed
-        // we can by-pass that for no-compression case
-        const auto compressionType = KCompressionDevice::compressionTypeForMimeType(m_mimeType);
-        if (compressionType == KCompressionDevice::None) {
-            m_file.reset(new QFile(filename));
-        } else {
-            m_file.reset(new KCompressionDevice(filename, compressionType));
-        }
+        m_compressionType = KCompressionDevice::compressionTypeForMimeType(m_mimeType);
+        m_file = createDevice();
     }
 
     /**
@@ -89,23 +107,142 @@ public:
         m_alreadyScanned = -1;
         m_eol = TextBuffer::eolUnknown;
         m_text.clear();
+        m_textOffset = 0;
+        m_firstNonAscii = std::numeric_limits<qint64>::max();
         m_converterState = m_codec.isEmpty() ? QStringDecoder() : QStringDecoder(m_codec.toUtf8().constData());
         m_bomFound = false;
         m_firstRead = true;
+        m_bytePosition = 0;
 
         // init the hash with the git header
         const QString header = QStringLiteral("blob %1").arg(m_fileSize);
         m_digest.reset();
         m_digest.addData(QByteArray(header.toLatin1() + '\0'));
+        m_digestedBytes = 0;
 
-        // if already opened, close the file...
+        // if already opened, close the file, this will unmap it, too
+        m_mappedData = nullptr;
+        m_mappedPosition = 0;
         if (m_file->isOpen()) {
             m_file->close();
         }
 
         // open via unbuffered file, we read ourself into a large chunked buffer
         // might have no effect for compressed files, but at least for the uncompressed common case
-        return m_file->open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+        if (!m_file->open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+            return false;
+        }
+
+        // for uncompressed local files try to map them, we then decode directly from the mapped memory
+        // and avoid to copy all data into our read buffer, on failure we just fall back to reading
+        // files on network or FUSE file systems are not mapped, a failing read there would kill us with SIGBUS
+        if (m_fileSize > 0 && m_compressionType == KCompressionDevice::None && isLocalFileSystem()) {
+            m_mappedData = static_cast<QFile *>(m_file.get())->map(0, m_fileSize);
+        }
+
+        // the read buffer is only needed if we didn't map the file
+        if (m_mappedData) {
+            m_buffer = QByteArray();
+        } else if (m_buffer.isEmpty()) {
+            m_buffer.resize(KATE_FILE_LOADER_BS);
+        }
+        return true;
+    }
+
+    /**
+     * Position in the file at which decoding of the line at the given offset could be resumed with an other codec.
+     * That is possible if all text in front of the line is ASCII and the current codec is ASCII compatible,
+     * any other ASCII compatible codec will then decode the text in front of the line the same way.
+     * @param offset offset into internal Unicode data of the line start, as returned by readLine
+     * @return byte position of the line start in the file or -1 if not possible
+     */
+    qint64 resumePosition(int offset) const
+    {
+        const qint64 position = m_textOffset + offset;
+        if (m_bomFound || m_firstNonAscii < position || !isAsciiCompatible(m_codec)) {
+            return -1;
+        }
+        return position;
+    }
+
+    /**
+     * Continue to read the already opened file with an other codec at the given position.
+     * Detected eol mode and digest state are kept, the digest will only be updated for data not seen before.
+     * @param codec codec to use, must be ASCII compatible
+     * @param position position to resume, as returned by resumePosition
+     * @return success
+     */
+    bool resume(const QString &codec, qint64 position)
+    {
+        Q_ASSERT(isAsciiCompatible(codec));
+        Q_ASSERT(m_file->isOpen());
+
+        m_codec = codec;
+        m_eof = false;
+        m_lastWasEndOfLine = true;
+        m_lastWasR = false;
+        m_position = 0;
+        m_lastLineStart = 0;
+        m_alreadyScanned = -1;
+        m_text.clear();
+        m_textOffset = position;
+        m_converterState = QStringDecoder(m_codec.toUtf8().constData());
+        m_firstRead = false;
+        m_bytePosition = position;
+
+        if (m_mappedData) {
+            m_mappedPosition = position;
+            return true;
+        }
+        return m_file->seek(position);
+    }
+
+    /**
+     * Detect the codec for the file, like open() with an empty codec does, but only using a bounded prefix of the file.
+     * @return detected codec name, empty if nothing was detected
+     */
+    QString detectTextCodec()
+    {
+        const QStringDecoder decoder = detectDecoder(prefix());
+        return decoder.isValid() ? QString::fromUtf8(decoder.name()) : QString();
+    }
+
+    /**
+     * Check if the given codec is able to decode a bounded prefix of the file without errors.
+     * Allows to skip loading rounds that would fail early without reading the whole file.
+     * @param codec codec to check
+     * @return true if no encoding errors occurred in the prefix
+     */
+    bool prefixDecodesWithoutErrors(const QString &codec)
+    {
+        QStringDecoder decoder(codec.toUtf8().constData());
+        if (!decoder.isValid()) {
+            return false;
+        }
+
+        // an incomplete sequence at the end of the prefix is kept as decoder state, no error
+        [[maybe_unused]] const QString text = decoder.decode(prefix());
+        return !decoder.hasError();
+    }
+
+    /**
+     * Does the given codec decode ASCII the same way as Latin-1?
+     * @param codec codec to check
+     * @return codec is ASCII compatible
+     */
+    static bool isAsciiCompatible(const QString &codec)
+    {
+        QStringDecoder decoder(codec.toUtf8().constData());
+        if (!decoder.isValid()) {
+            return false;
+        }
+
+        QByteArray ascii(0x80, Qt::Uninitialized);
+        for (int i = 0; i < ascii.size(); ++i) {
+            ascii[i] = char(i);
+        }
+        const QString text = decoder.decode(ascii);
+        return !decoder.hasError() && text == QLatin1StringView(ascii);
     }
 
     /**
@@ -204,15 +341,7 @@ public:
             longestLineLoaded = std::max(longestLineLoaded, textLength);
 
             // search for place to wrap
-            int spacePosition = m_lineLengthLimit - 1;
-            for (int testPosition = m_lineLengthLimit - 1; (testPosition >= 0) && (testPosition >= (m_lineLengthLimit - (m_lineLengthLimit / 10)));
-                 --testPosition) {
-                // wrap place found?
-                if (m_text[lineStart + testPosition].isSpace() || m_text[lineStart + testPosition].isPunct()) {
-                    spacePosition = testPosition;
-                    break;
-                }
-            }
+            const int spacePosition = wrapPosition(m_text, lineStart);
 
             m_lastWasEndOfLine = false;
             m_lastWasR = false;
@@ -239,31 +368,35 @@ public:
                 if (!m_eof) {
                     // kill the old lines...
                     m_text.remove(0, m_lastLineStart);
-
-                    // try to read new data
-                    const int c = m_file->read(m_buffer.data(), m_buffer.size());
+                    m_textOffset += m_lastLineStart;
+
+                    // try to read new data, either the next chunk of the mapped file or from the device
+                    const char *data = m_buffer.constData();
+                    qint64 c = 0;
+                    if (m_mappedData) {
+                        data = reinterpret_cast<const char *>(m_mappedData) + m_mappedPosition;
+                        c = nextMappedChunkSize();
+                        m_mappedPosition += c;
+                    } else {
+                        c = m_file->read(m_buffer.data(), m_buffer.size());
+                    }
 
                     // if any text is there, append it....
                     if (c > 0) {
-                        // update hash sum
-                        m_digest.addData(QByteArrayView(m_buffer.data(), c));
+                        const QByteArrayView chunk(data, c);
+
+                        // update hash sum, skip data already seen before we resumed at an earlier position
+                        if (m_bytePosition + c > m_digestedBytes) {
+                            m_digest.addData(chunk.sliced(std::max<qint64>(0, m_digestedBytes - m_bytePosition)));
+                            m_digestedBytes = m_bytePosition + c;
+                        }
+                        m_bytePosition += c;
 
                         // detect byte order marks & codec for byte order marks on first read
                         if (m_firstRead) {
                             // if no codec given, do autodetection
                             if (!m_converterState.isValid()) {
-                                // use KEncodingProber first, QStringDecoder::decoderForHtml does fallback to UTF-8
-                                KEncodingProber prober(m_proberType);
-                                prober.feed(QByteArrayView(m_buffer.data(), c));
-
-                                // we found a codec with some confidence?
-                                if (const QStringDecoder decoder(prober.encoding().constData()); decoder.isValid() && (prober.confidence() > 0.5)) {
-                                    m_converterState = QStringDecoder(prober.encoding().constData());
-                                } else {
-                                    // try to get HTML encoding, will default to UTF-8
-                                    // see https://doc.qt.io/qt-6/qstringdecoder.html#decoderForHtml
-                                    m_converterState = QStringDecoder::decoderForHtml(m_buffer);
-                                }
+                                m_converterState = detectDecoder(chunk);
 
                                 // no codec, no chance, encoding error, else remember the codec name
                                 if (!m_converterState.isValid()) {
@@ -280,9 +413,19 @@ public:
 
                         // detect broken encoding
                         Q_ASSERT(m_converterState.isValid());
-                        const QString unicode = m_converterState.decode(QByteArrayView(m_buffer.data(), c));
+                        const QString unicode = m_converterState.decode(chunk);
                         encodingError = encodingError || m_converterState.hasError();
 
+                        // remember position of first non-ASCII character, needed to decide if we can resume with an other codec
+                        if (m_firstNonAscii == std::numeric_limits<qint64>::max()) {
+                            const auto it = std::find_if(unicode.cbegin(), unicode.cend(), [](QChar c) {
+                                return c.unicode() >= 0x80;
+                            });
+                            if (it != unicode.cend()) {
+                                m_firstNonAscii = m_textOffset + m_text.size() + (it - unicode.cbegin());
+                            }
+                        }
+
                         // check and remove bom
                         if (m_firstRead && !unicode.isEmpty() && (unicode.front() == QChar::ByteOrderMark || unicode.front() == QChar::ByteOrderSwapped)) {
                             m_bomFound = true;
@@ -402,6 +545,319 @@ public:
         return m_digest.result();
     }
 
+    /**
+     * Lines of one decoded chunk, result of decodeChunk
+     */
+    struct ChunkLines {
+        /**
+         * decoded text of the chunk
+         */
+        QString text;
+
+        /**
+         * offset and length of each line in text
+         */
+        std::vector<std::pair<int, int>> lines;
+
+        bool encodingError = false;
+        bool tooLongLinesWrapped = false;
+        int longestLineLoaded = 0;
+
+        /**
+         * end of line types seen in this chunk
+         */
+        bool foundDos = false;
+        bool foundUnix = false;
+        bool foundMac = false;
+    };
+
+    /**
+     * Can the file be read in parallel via parallelChunks() and decodeChunk()?
+     * This is possible for large uncompressed files that got mapped to memory and use a
+     * stateless codec in which line feeds can't be part of multi-byte sequences (UTF-8, Latin-1).
+     * Files starting with a byte order mark are left to readLine.
+     * Must be called directly after open().
+     * @return parallel reading possible
+     */
+    bool canReadParallel() const
+    {
+        if (!m_mappedData || m_fileSize < quint64(KATE_FILE_LOADER_PARALLEL_SIZE)) {
+            return false;
+        }
+
+        const auto encoding = QStringConverter::encodingForName(m_codec.toUtf8().constData());
+        if (!encoding || (*encoding != QStringConverter::Utf8 && *encoding != QStringConverter::Latin1)) {
+            return false;
+        }
+
+        return !availableMappedData(QByteArrayView(m_mappedData, 3)).startsWith("\xEF\xBB\xBF");
+    }
+
+    /**
+     * Split the mapped file in chunks of about KATE_FILE_LOADER_PARALLEL_CHUNK_SIZE bytes.
+     * Each chunk ends after a line feed or at the end of the file.
+     * @return chunks in file order
+     */
+    std::vector<QByteArrayView> parallelChunks() const
+    {
+        Q_ASSERT(m_mappedData);
+        std::vector<QByteArrayView> chunks;
+        const char *data = reinterpret_cast<const char *>(m_mappedData);
+        const qint64 size = m_fileSize;
+        qint64 start = 0;
+        while (start < size) {
+            qint64 end = std::min(start + KATE_FILE_LOADER_PARALLEL_CHUNK_SIZE, size);
+            if (end < size) {
+                const void *lf = memchr(data + end, '\n', size - end);
+                end = lf ? (static_cast<const char *>(lf) - data + 1) : size;
+            }
+            chunks.emplace_back(data + start, end - start);
+            start = end;
+        }
+        return chunks;
+    }
+
+    /**
+     * Part of a chunk of the mapped file that is still backed by the file.
+     * If the file got truncated while we load it, accessing the mapped memory behind its end would kill us with SIGBUS.
+     * Call this directly before touching the chunk, can be called concurrently from multiple threads.
+     * @param chunk chunk of the mapped file, e.g. as returned by parallelChunks
+     * @return chunk, cut at the current end of the file
+     */
+    QByteArrayView availableMappedData(QByteArrayView chunk) const
+    {
+        const qint64 start = reinterpret_cast<const uchar *>(chunk.data()) - m_mappedData;
+        return chunk.first(std::clamp<qint64>(mappedFileSize() - start, 0, chunk.size()));
+    }
+
+    /**
+     * Decode one chunk of the file and split it into lines, the same way readLine would do.
+     * Only uses immutable state, can be called concurrently from multiple threads.
+     * @param chunk chunk to decode, as returned by parallelChunks
+     * @param lastChunk is this the last chunk of the file? then the text after the last end of line is a line, too
+     * @return decoded lines of the chunk
+     */
+    ChunkLines decodeChunk(QByteArrayView chunk, bool lastChunk) const
+    {
+        ChunkLines result;
+        QStringDecoder decoder(m_codec.toUtf8().constData());
+        result.text = decoder.decode(chunk);
+        result.encodingError = decoder.hasError();
+
+        // honor the line length limit like readLine does
+        const auto appendLine = [this, &result](int lineStart, int length) {
+            while ((m_lineLengthLimit > 0) && (length > m_lineLengthLimit)) {
+                result.tooLongLinesWrapped = true;
+                result.longestLineLoaded = std::max(result.longestLineLoaded, length);
+                const int wrappedLength = wrapPosition(result.text, lineStart) + 1;
+                result.lines.emplace_back(lineStart, wrappedLength);
+                lineStart += wrappedLength;
+                length -= wrappedLength;
+            }
+            result.lines.emplace_back(lineStart, length);
+        };
+
+        const QString &text = result.text;
+        int lineStart = 0;
+        bool lastWasR = false;
+        for (int position = 0; position < text.size(); ++position) {
+            const QChar c = text.at(position);
+            if (c == QLatin1Char('\n')) {
+                if (lastWasR) {
+                    lastWasR = false;
+                    result.foundDos = true;
+                } else {
+                    appendLine(lineStart, position - lineStart);
+                    result.foundUnix = true;
+                }
+                lineStart = position + 1;
+            } else if (c == QLatin1Char('\r')) {
+                lastWasR = true;
+                appendLine(lineStart, position - lineStart);
+                lineStart = position + 1;
+                result.foundMac = true;
+            } else if (c == QChar::LineSeparator) {
+                appendLine(lineStart, position - lineStart);
+                lineStart = position + 1;
+            } else {
+                lastWasR = false;
+            }
+        }
+
+        // chunks end with a line feed, only for the last one we need to take care of the remaining text
+        if (lastChunk) {
+            appendLine(lineStart, text.size() - lineStart);
+        }
+        return result;
+    }
+
+    /**
+     * Add the end of line types found in the chunk to the detected eol mode.
+     * Like for readLine, dos wins over unix and unix over mac.
+     * @param chunk decoded chunk
+     */
+    void addEndOfLineMode(const ChunkLines &chunk)
+    {
+        if (chunk.foundDos) {
+            m_eol = TextBuffer::eolDos;
+        } else if (chunk.foundUnix && m_eol != TextBuffer::eolDos) {
+            m_eol = TextBuffer::eolUnix;
+        } else if (chunk.foundMac && m_eol == TextBuffer::eolUnknown) {
+            m_eol = TextBuffer::eolMac;
+        }
+    }
+
+    /**
+     * Add all data of the mapped file not hashed up to now to the digest.
+     * Can run in an own thread in parallel to decodeChunk.
+     */
+    void digestMappedData()
+    {
+        Q_ASSERT(m_mappedData);
+        const qint64 size = mappedFileSize();
+        if (m_digestedBytes < size) {
+            m_digest.addData(QByteArrayView(m_mappedData + m_digestedBytes, size - m_digestedBytes));
+            m_digestedBytes = size;
+        }
+    }
+
+private:
+    /**
+     * Is the file on a local file system?
+     * Only then we map it, on network file systems a read error can happen at any time.
+     * @return file is local
+     */
+    bool isLocalFileSystem() const
+    {
+        switch (KFileSystemType::fileSystemType(m_filename)) {
+        case KFileSystemType::Nfs:
+        case KFileSystemType::Smb:
+        case KFileSystemType::Fuse:
+        case KFileSystemType::Unknown:
+            return false;
+        default:
+            return true;
+        }
+    }
+
+    /**
+     * Size of the mapped part of the file that is still backed by the file.
+     * The file is asked again on each call, it might have been truncated since we mapped it.
+     * @return bytes that can be accessed, at most the mapped size
+     */
+    qint64 mappedFileSize() const
+    {
+#ifdef Q_OS_UNIX
+        // ask the opened file, not the file name, the file name might point to a replacement by now
+        struct stat status;
+        if (::fstat(static_cast<const QFile *>(m_file.get())->handle(), &status) != 0) {
+            return 0;
+        }
+        return std::min<qint64>(status.st_size, m_fileSize);
+#else
+        // mapped files can't be truncated on other platforms
+        return m_fileSize;
+#endif
+    }
+
+    /**
+     * Size of the next chunk of the mapped file to decode in readLine.
+     * For codecs in which line feeds can't be part of multi-byte sequences the chunk is ended
+     * after the last line feed found in the mapped bytes, then no line is split between two chunks
+     * and we never need to move the start of an incomplete line around in m_text.
+     * @return bytes to decode, 0 at the end of the file
+     */
+    qint64 nextMappedChunkSize() const
+    {
+        const qint64 size = mappedFileSize();
+        const qint64 available = std::max<qint64>(0, size - m_mappedPosition);
+        if (available <= KATE_FILE_LOADER_BS) {
+            return available;
+        }
+
+        const auto encoding = QStringConverter::encodingForName(m_codec.toUtf8().constData());
+        if (m_firstRead || !encoding || (*encoding != QStringConverter::Utf8 && *encoding != QStringConverter::Latin1)) {
+            return KATE_FILE_LOADER_BS;
+        }
+
+        // look back for the last line feed in the window, a line longer than the window is still decoded in parts
+        const char *data = reinterpret_cast<const char *>(m_mappedData) + m_mappedPosition;
+        for (qint64 end = KATE_FILE_LOADER_BS; end > 0; --end) {
+            if (data[end - 1] == '\n') {
+                return end;
+            }
+        }
+        return KATE_FILE_LOADER_BS;
+    }
+
+    /**
+     * Create the device to read the file, a filter device for compressed files.
+     */
+    std::unique_ptr<QIODevice> createDevice() const
+    {
+        // we can by-pass the filter device for no-compression case
+        if (m_compressionType == KCompressionDevice::None) {
+            return std::make_unique<QFile>(m_filename);
+        }
+        return std::make_unique<KCompressionDevice>(m_filename, m_compressionType);
+    }
+
+    /**
+     * Bounded prefix of the file, read on first use via an own device.
+     * @return at most KATE_FILE_LOADER_SNIFF_SIZE bytes from the start of the file
+     */
+    const QByteArray &prefix()
+    {
+        if (!m_prefixRead) {
+            m_prefixRead = true;
+            if (auto file = createDevice(); file->open(QIODevice::ReadOnly)) {
+                m_prefix = file->read(KATE_FILE_LOADER_SNIFF_SIZE);
+            }
+        }
+        return m_prefix;
+    }
+
+    /**
+     * Find the position to wrap a too long line, prefer to wrap after spaces or punctuation.
+     * @param text text containing the line
+     * @param lineStart start of the line in text
+     * @return offset of last character to keep in the line
+     */
+    int wrapPosition(const QString &text, int lineStart) const
+    {
+        int spacePosition = m_lineLengthLimit - 1;
+        for (int testPosition = m_lineLengthLimit - 1; (testPosition >= 0) && (testPosition >= (m_lineLengthLimit - (m_lineLengthLimit / 10)));
+             --testPosition) {
+            // wrap place found?
+            if (text[lineStart + testPosition].isSpace() || text[lineStart + testPosition].isPunct()) {
+                spacePosition = testPosition;
+                break;
+            }
+        }
+        return spacePosition;
+    }
+
+    /**
+     * Detect decoder for the given data.
+     * @param data start of the file
+     * @return detected decoder, invalid if none found
+     */
+    QStringDecoder detectDecoder(QByteArrayView data) const
+    {
+        // use KEncodingProber first, QStringDecoder::decoderForHtml does fallback to UTF-8
+        KEncodingProber prober(m_proberType);
+        prober.feed(data);
+
+        // we found a codec with some confidence?
+        if (const QStringDecoder decoder(prober.encoding().constData()); decoder.isValid() && (prober.confidence() > 0.5)) {
+            return QStringDecoder(prober.encoding().constData());
+        }
+
+        // try to get HTML encoding, will default to UTF-8
+        // see https://doc.qt.io/qt-6/qstringdecoder.html#decoderForHtml
+        return QStringDecoder::decoderForHtml(data);
+    }
+
 private:
     QString m_codec;
     bool m_eof;
@@ -412,7 +868,10 @@ private:
     int m_alreadyScanned = -1;
     TextBuffer::EndOfLineMode m_eol;
     QString m_mimeType;
+    KCompressionDevice::CompressionType m_compressionType;
     std::unique_ptr<QIODevice> m_file;
+    const uchar *m_mappedData = nullptr;
+    qint64 m_mappedPosition = 0;
     QByteArray m_buffer;
     QCryptographicHash m_digest;
     QString m_text;
@@ -422,6 +881,13 @@ private:
     KEncodingProber::ProberType m_proberType;
     quint64 m_fileSize;
     const int m_lineLengthLimit;
+    const QString m_filename;
+    qint64 m_textOffset = 0;
+    qint64 m_firstNonAscii = std::numeric_limits<qint64>::max();
+    qint64 m_bytePosition = 0;
+    qint64 m_digestedBytes = 0;
+    QByteArray m_prefix;
+    bool m_prefixRead = false;
 };
 
 }
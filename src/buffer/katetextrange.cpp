@@ -23,6 +23,8 @@ TextRange::TextRange(TextBuffer *buffer, KTextEditor::Range range, InsertBehavio
     , m_attributeOnlyForViews(false)
     , m_invalidateIfEmpty(emptyBehavior == InvalidateIfEmpty)
 {
+    ++m_buffer->m_rangeCount;
+
     // check if range now invalid, there can happen no feedback, as m_feedback == 0
     // only place where KTextEditor::LineRange::invalid() for old range makes sense, as we were yet not registered!
     checkValidity();
@@ -38,6 +40,8 @@ TextRange::~TextRange()
     if (!m_buffer) {
         return;
     }
+    --m_buffer->m_rangeCount;
+
     // reset feedback, don't want feedback during destruction
     const bool hadFeedBack = m_feedback != nullptr;
     const bool hadDynamicAttr = m_attribute
@@ -45,6 +49,11 @@ TextRange::~TextRange()
     const bool notifyDeletion = hadFeedBack || hadDynamicAttr;
     m_feedback = nullptr;
 
+    // no notifications for deleted ranges
+    if (m_pendingFeedbackNotification >= 0) {
+        m_buffer->removePendingFeedbackNotification(this);
+    }
+
     // remove range from cached multiline ranges
     const auto lineRange = toLineRange();
     if (lineRange.isValid() && spansMultipleBlocks()) {
@@ -200,14 +209,29 @@ void TextRange::checkValidity(bool notifyAboutChange)
 
     // perhaps need to notify stuff!
     if (notifyAboutChange && m_feedback && m_buffer) {
-        m_buffer->notifyAboutRangeChange(m_view, toLineRange(), false /* attribute not interesting here */);
-
-        // do this last: may delete this range
-        if (!toRange().isValid()) {
-            m_feedback->rangeInvalid(this);
-        } else if (toRange().isEmpty()) {
-            m_feedback->rangeEmpty(this);
+        // during editing, ranges that stay valid are notified only once after the last transaction is finished
+        if (start.isValid() && m_buffer->editingTransactions() > 0) {
+            m_buffer->addPendingFeedbackNotification(this);
+            return;
         }
+
+        notifyFeedbackAboutChange();
+    }
+}
+
+void TextRange::notifyFeedbackAboutChange()
+{
+    if (!m_feedback || !m_buffer) {
+        return;
+    }
+
+    m_buffer->notifyAboutRangeChange(m_view, toLineRange(), false /* attribute not interesting here */);
+
+    // do this last: may delete this range
+    if (!toRange().isValid()) {
+        m_feedback->rangeInvalid(this);
+    } else if (toRange().isEmpty()) {
+        m_feedback->rangeEmpty(this);
     }
 }
 
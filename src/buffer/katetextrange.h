@@ -345,6 +345,13 @@ private:
         return m_isCheckValidityRequired;
     }
 
+    /**
+     * Notify the feedback about the current state of this range, see checkValidity().
+     *
+     * IMPORTANT: Notifications might need to deletion of this range!
+     */
+    void notifyFeedbackAboutChange();
+
 private:
     /**
      * parent text buffer
@@ -402,6 +409,12 @@ private:
      * Reset by checkValidity().
      */
     bool m_isCheckValidityRequired = false;
+
+    /**
+     * Index in the queue of feedback notifications waiting for the running editing transaction to finish, -1 if none is queued.
+     * Set and reset by TextBuffer.
+     */
+    qsizetype m_pendingFeedbackNotification = -1;
 };
 
 }
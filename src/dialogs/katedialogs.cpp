@@ -1018,6 +1018,8 @@ KateSaveConfigTab::KateSaveConfigTab(QWidget *parent)
     observeChanges(uiadv->spbSwapFileSync);
     observeChanges(uiadv->chkEditorConfig);
     observeChanges(uiadv->chkUseFirstLineAsDocName);
+    observeChanges(uiadv->chkHighlightingCache);
+    observeChanges(uiadv->chkProgressiveLoading);
 
     internalLayout->addWidget(newWidget);
     internalLayout2->addWidget(newWidget2);
@@ -1126,6 +1128,8 @@ void KateSaveConfigTab::apply()
     KateDocumentConfig::global()->setValue(KateDocumentConfig::AutoReloadOnExternalChanges, uiadv->chkAutoReloadOnExternalChanges->isChecked());
     KateDocumentConfig::global()->setValue(KateDocumentConfig::UseEditorConfig, uiadv->chkEditorConfig->isChecked());
     KateDocumentConfig::global()->setValue(KateDocumentConfig::UseFirstLineAsDocName, uiadv->chkUseFirstLineAsDocName->isChecked());
+    KateDocumentConfig::global()->setValue(KateDocumentConfig::HighlightingCache, uiadv->chkHighlightingCache->isChecked());
+    KateDocumentConfig::global()->setValue(KateDocumentConfig::ProgressiveLoading, uiadv->chkProgressiveLoading->isChecked());
 
     KateDocumentConfig::global()->configEnd();
     KateGlobalConfig::global()->configEnd();
@@ -1198,6 +1202,8 @@ void KateSaveConfigTab::reload()
     uiadv->chkAutoReloadOnExternalChanges->setChecked(KateDocumentConfig::global()->value(KateDocumentConfig::AutoReloadOnExternalChanges).toBool());
     uiadv->chkEditorConfig->setChecked(KateDocumentConfig::global()->value(KateDocumentConfig::UseEditorConfig).toBool());
     uiadv->chkUseFirstLineAsDocName->setChecked(KateDocumentConfig::global()->value(KateDocumentConfig::UseFirstLineAsDocName).toBool());
+    uiadv->chkHighlightingCache->setChecked(KateDocumentConfig::global()->value(KateDocumentConfig::HighlightingCache).toBool());
+    uiadv->chkProgressiveLoading->setChecked(KateDocumentConfig::global()->value(KateDocumentConfig::ProgressiveLoading).toBool());
 }
 
 void KateSaveConfigTab::reset()
@@ -24,6 +24,43 @@
 #include <QStringEncoder>
 #include <QTextStream>
 
+#include <algorithm>
+#include <limits>
+
+/**
+ * lines highlighted by one background highlighting job, the results are shown after each job
+ */
+static const int KATE_BUFFER_BACKGROUND_HIGHLIGHTING_CHUNK = 8192;
+
+/**
+ * columns highlighted after the window of a long line, the highlighting of its last columns might depend on them
+ */
+static const int KATE_BUFFER_LONG_LINE_WINDOW_MARGIN = 1024;
+
+/**
+ * attribute lists up to this size are shared among lines with equal attributes, longer ones are seldom equal
+ */
+static const int KATE_BUFFER_SHARED_ATTRIBUTES_SIZE = 16;
+
+/**
+ * maximal number of distinct attribute lists shared among lines
+ */
+static const int KATE_BUFFER_SHARED_ATTRIBUTES_COUNT = 4096;
+
+/**
+ * Snapshot of lines highlighted by the background worker.
+ * The lines are copies of the buffer lines, only their text is shared, the job
+ * highlights them in place and the results are taken over by the buffer afterwards.
+ */
+struct KateBackgroundHighlightingJob {
+    std::shared_ptr<KateHighlighting> highlight;
+    qint64 revision = -1;
+    quint64 generation = 0;
+    int startLine = 0;
+    KSyntaxHighlighting::State startState;
+    std::vector<Kate::TextLine> lines;
+};
+
 /**
  * Create an empty buffer. (with one block with one empty line)
  */
@@ -37,12 +74,21 @@ KateBuffer::KateBuffer(KTextEditor::DocumentPrivate *doc)
     , m_tabWidth(8)
     , m_lineHighlighted(0)
 {
+    connect(this, &Kate::TextBuffer::loadingFinished, this, &KateBuffer::finishOpenFile);
+
+    // jobs must run one after the other, each continues with the state of the previous one
+    m_backgroundHighlightingPool.setMaxThreadCount(1);
 }
 
 /**
  * Cleanup on destruction
  */
-KateBuffer::~KateBuffer() = default;
+KateBuffer::~KateBuffer()
+{
+    // a running background job must not outlive us
+    m_backgroundHighlightingCancelled = true;
+    m_backgroundHighlightingPool.waitForDone();
+}
 
 void KateBuffer::editStart()
 {
@@ -78,8 +124,13 @@ void KateBuffer::updateHighlighting()
         return;
     }
 
+    // the states after the first changed line are unknown now
+    forgetHighlightingAfter(editingMinimalLineChanged());
+
     // if we don't touch the highlighted area => fine
+    // the lines highlighted before the last edit are only valid up to the change
     if (editingMinimalLineChanged() > m_lineHighlighted) {
+        m_lineHighlightedBeforeEdit = qMin(m_lineHighlightedBeforeEdit, editingMinimalLineChanged());
         return;
     }
 
@@ -90,6 +141,16 @@ void KateBuffer::updateHighlighting()
 
 void KateBuffer::clear()
 {
+    // the text as on disk might be highlighted completely, remember that for the next time
+    saveHighlightingCache();
+
+    // remember the checkpoints of text as on disk, they are valid again if the same file is loaded again
+    // clear() is called again during loading, the text is empty then
+    if (revision() == m_revisionOnDisk && !digest().isEmpty()) {
+        m_checkpointsForReloadDigest = digest();
+        m_checkpointsForReload = highlightingCheckpoints();
+    }
+
     // call original clear function
     Kate::TextBuffer::clear();
 
@@ -100,6 +161,17 @@ void KateBuffer::clear()
 
     // back to line 0 with hl
     m_lineHighlighted = 0;
+    m_lineHighlightedBeforeEdit = 0;
+    m_highlightingCheckpoints.clear();
+    m_checkpointHighlightedStart = m_checkpointHighlightedEnd = -1;
+    ++m_pagedHighlightingTag;
+    m_revisionOnDisk = -1;
+    m_highlightingCache.reset();
+    m_cachedHighlightingEnd = 0;
+    m_cachedHighlightingBlocks.clear();
+    m_windowHighlightedLine = -1;
+    m_sharedAttributes.clear();
+    m_sharedAttributesMemory = 0;
 }
 
 bool KateBuffer::openFile(const QString &m_file, bool enforceTextCodec)
@@ -149,11 +221,50 @@ bool KateBuffer::openFile(const QString &m_file, bool enforceTextCodec)
         return false;
     }
 
+    // if wanted, large files are loaded progressively, the first lines are shown at once
+    // else they are decoded on multiple threads and the document is complete once opened
+    // not on reload, there the cursors and marks will be restored right after loading
+    setProgressiveLoading(m_doc->config()->progressiveLoading() && fileInfo.size() >= KATE_BUFFER_PROGRESSIVE_LOADING_SIZE && !m_doc->m_reloading);
+
+    // large files keep their Latin-1 lines in 8-bit form until they are modified
+    setCompactLineStorage(fileInfo.size() >= KATE_BUFFER_COMPACT_STORAGE_SIZE);
+
+    // huge files are only scanned for line ends, their lines are read from the file when needed
+    setPagedLoading(fileInfo.size() >= KATE_BUFFER_PAGED_LOADING_SIZE);
+
     // try to load
     if (!load(m_file, m_brokenEncoding, m_tooLongLinesWrapped, m_longestLineLoaded, enforceTextCodec)) {
         return false;
     }
 
+    // progressive load: rest is done in finishOpenFile
+    if (isLoading()) {
+        return true;
+    }
+
+    applyLoadedFileSettings();
+    restoreCheckpointsForReload();
+    loadHighlightingCache();
+
+    // okay, loading did work
+    return true;
+}
+
+void KateBuffer::finishOpenFile(bool encodingErrors, bool tooLongLinesWrapped, int longestLineLoaded)
+{
+    m_brokenEncoding = encodingErrors;
+    m_tooLongLinesWrapped = tooLongLinesWrapped;
+    m_longestLineLoaded = longestLineLoaded;
+
+    applyLoadedFileSettings();
+    restoreCheckpointsForReload();
+    loadHighlightingCache();
+
+    Q_EMIT fileLoaded();
+}
+
+void KateBuffer::applyLoadedFileSettings()
+{
     // save back encoding
     m_doc->config()->setEncoding(textCodec());
 
@@ -166,8 +277,93 @@ bool KateBuffer::openFile(const QString &m_file, bool enforceTextCodec)
     if (generateByteOrderMark()) {
         m_doc->config()->setBom(true);
     }
+}
 
-    // okay, loading did work
+void KateBuffer::restoreCheckpointsForReload()
+{
+    m_revisionOnDisk = revision();
+    if (!m_checkpointsForReloadDigest.isEmpty() && m_checkpointsForReloadDigest == digest()) {
+        setHighlightingCheckpoints(std::move(m_checkpointsForReload));
+    }
+    m_checkpointsForReloadDigest.clear();
+    m_checkpointsForReload.clear();
+}
+
+bool KateBuffer::canUseHighlightingCache() const
+{
+    // only worth it for large texts, they must be as on disk to be found again
+    return m_doc->config()->highlightingCache() && m_highlight && !m_highlight->noHighlighting() && !isPaged()
+        && lines() >= KATE_BUFFER_BACKGROUND_HIGHLIGHTING_LINES && revision() == m_revisionOnDisk && !digest().isEmpty();
+}
+
+void KateBuffer::loadHighlightingCache()
+{
+    m_highlightingCache.reset();
+    m_cachedHighlightingEnd = 0;
+    m_cachedHighlightingBlocks.clear();
+    if (!canUseHighlightingCache()) {
+        return;
+    }
+
+    // the blocks are read once the lines are painted
+    auto cache = std::make_unique<KateHighlightingCache>();
+    if (!cache->open(KateHighlightingCache::fileName(digest(), m_highlight->definition()), lines())) {
+        return;
+    }
+    m_cachedHighlightingBlocks.resize(cache->blocks(), false);
+    m_cachedHighlightingEnd = lines();
+    m_highlightingCache = std::move(cache);
+}
+
+void KateBuffer::saveHighlightingCache()
+{
+    // the states of the lines are not cached, only completely highlighted texts are useful
+    if (!canUseHighlightingCache() || m_lineHighlighted < lines()) {
+        return;
+    }
+
+    // the same text was cached before
+    const QString fileName = KateHighlightingCache::fileName(digest(), m_highlight->definition());
+    if (!QFile::exists(fileName)) {
+        KateHighlightingCache::write(fileName, *this);
+    }
+}
+
+bool KateBuffer::highlightFromCache(int line, int lookAhead)
+{
+    if (line >= m_cachedHighlightingEnd) {
+        return false;
+    }
+
+    // take over the blocks not taken over before
+    const int endLine = qMin(line + lookAhead, m_cachedHighlightingEnd - 1);
+    std::vector<Kate::TextLine> cachedLines;
+    for (int block = line / KATE_HIGHLIGHTING_CACHE_BLOCK_LINES; block <= endLine / KATE_HIGHLIGHTING_CACHE_BLOCK_LINES; ++block) {
+        if (m_cachedHighlightingBlocks[block]) {
+            continue;
+        }
+
+        // broken file, forget about it, the lines are highlighted as usual
+        if (!m_highlightingCache->readBlock(block, *this, int(m_highlight->formats().size()), cachedLines)) {
+            qCWarning(LOG_KTE) << "Broken highlighting cache file";
+            m_highlightingCache.reset();
+            m_cachedHighlightingEnd = 0;
+            m_cachedHighlightingBlocks.clear();
+            return false;
+        }
+
+        // the lines really highlighted already keep their highlighting state
+        const int firstLine = block * KATE_HIGHLIGHTING_CACHE_BLOCK_LINES;
+        const int lastLine = qMin(firstLine + int(cachedLines.size()), m_cachedHighlightingEnd);
+        for (int cachedLine = qMax(firstLine, m_lineHighlighted); cachedLine < lastLine; ++cachedLine) {
+            if (!isCheckpointHighlighted(cachedLine)) {
+                Kate::TextLine &textLine = lineForMetaData(cachedLine);
+                textLine.takeHighlighting(cachedLines[cachedLine - firstLine]);
+                shareAttributes(textLine);
+            }
+        }
+        m_cachedHighlightingBlocks[block] = true;
+    }
     return true;
 }
 
@@ -232,6 +428,9 @@ bool KateBuffer::saveFile(const QString &m_file)
     m_tooLongLinesWrapped = false;
     m_longestLineLoaded = 0;
 
+    // text is as on disk
+    m_revisionOnDisk = revision();
+
     // okay
     return true;
 }
@@ -243,11 +442,22 @@ void KateBuffer::ensureHighlighted(int line, int lookAhead)
         return;
     }
 
+    // paged lines are highlighted as long as they stay in memory
+    if (isPaged()) {
+        highlightPagedLines(line, lookAhead, std::numeric_limits<int>::max());
+        return;
+    }
+
     // already hl up-to-date for this line?
     if (line < m_lineHighlighted) {
         return;
     }
 
+    // less work if we can resume from a checkpoint after the highlighted area
+    if (highlightFromCheckpoint(line, lookAhead, std::numeric_limits<int>::max())) {
+        return;
+    }
+
     // update hl until this line + max lookAhead
     int end = qMin(line + lookAhead, lines() - 1);
 
@@ -255,6 +465,457 @@ void KateBuffer::ensureHighlighted(int line, int lookAhead)
     doHighlight(m_lineHighlighted, end, false);
 }
 
+bool KateBuffer::ensureHighlightedForPainting(int line, int lookAhead)
+{
+    // valid line at all?
+    if (line < 0 || line >= lines()) {
+        return false;
+    }
+
+    // paged lines are highlighted at once if a known state is close, else the worker computes the checkpoints up to them
+    if (isPaged()) {
+        if (highlightPagedLines(line, lookAhead, KATE_BUFFER_BACKGROUND_HIGHLIGHTING_LINES)) {
+            return true;
+        }
+        m_backgroundHighlightingTarget = qMax(m_backgroundHighlightingTarget, line);
+        startBackgroundHighlighting();
+        return false;
+    }
+
+    // already hl up-to-date for this line?
+    if (line < m_lineHighlighted) {
+        return true;
+    }
+
+    // the highlighting remembered on disk is as good
+    if (highlightFromCache(line, lookAhead)) {
+        return true;
+    }
+
+    // only a few lines missing, cheaper to do this at once
+    if (line - m_lineHighlighted < KATE_BUFFER_BACKGROUND_HIGHLIGHTING_LINES) {
+        const int longLine = firstLongLine(m_lineHighlighted, qMin(line + lookAhead, lines() - 1));
+        if (longLine < 0) {
+            ensureHighlighted(line, lookAhead);
+            return true;
+        }
+
+        // but not a very long line, highlight up to it
+        if (longLine > m_lineHighlighted) {
+            doHighlight(m_lineHighlighted, longLine - 1, false);
+
+            // the lines after the long line might be known to be valid, see doHighlight
+            if (m_lineHighlighted > longLine) {
+                return ensureHighlightedForPainting(line, lookAhead);
+            }
+        }
+        if (line < m_lineHighlighted) {
+            return true;
+        }
+
+        // the first columns of the long line are highlighted at once, the whole line and the lines after it in the background
+        if (line == longLine) {
+            highlightLongLineWindow(longLine);
+        }
+        m_backgroundHighlightingTarget = qMax(m_backgroundHighlightingTarget, qMin(line + lookAhead, lines() - 1));
+        startBackgroundHighlighting();
+        return line == longLine;
+    }
+
+    // bounded work if we can resume from a checkpoint close to the line
+    const bool highlighted = highlightFromCheckpoint(line, lookAhead, KATE_BUFFER_BACKGROUND_HIGHLIGHTING_LINES);
+
+    // let the worker highlight until this line + max lookAhead, the line is painted with its current highlighting meanwhile
+    m_backgroundHighlightingTarget = qMax(m_backgroundHighlightingTarget, qMin(line + lookAhead, lines() - 1));
+    startBackgroundHighlighting();
+    return highlighted;
+}
+
+void KateBuffer::shareAttributes(Kate::TextLine &textLine)
+{
+    if (textLine.attributesList().size() <= KATE_BUFFER_SHARED_ATTRIBUTES_SIZE) {
+        const qsizetype sharedCount = m_sharedAttributes.size();
+        textLine.shareAttributes(m_sharedAttributes, KATE_BUFFER_SHARED_ATTRIBUTES_COUNT);
+        if (m_sharedAttributes.size() > sharedCount) {
+            m_sharedAttributesMemory += textLine.attributesList().capacity() * sizeof(Kate::TextLine::Attribute);
+        }
+    }
+}
+
+int KateBuffer::firstLongLine(int startLine, int endLine) const
+{
+    // no hl around, no stuff to do
+    if (!m_highlight || m_highlight->noHighlighting() || isPaged()) {
+        return -1;
+    }
+
+    for (int line = startLine; line <= endLine; ++line) {
+        if (lineLength(line) >= KATE_BUFFER_LONG_LINE_LENGTH) {
+            return line;
+        }
+    }
+    return -1;
+}
+
+void KateBuffer::highlightLongLineWindow(int line)
+{
+    // highlighted already for the current text
+    if (line == m_windowHighlightedLine) {
+        return;
+    }
+
+    // highlight a copy of the first columns, its end state is not the one of the line
+    Kate::TextLine prevLine;
+    if (line >= 1) {
+        prevLine.setHighlightingState(plainLine(line - 1).highlightingState());
+    }
+    Kate::TextLine window(Kate::TextBuffer::line(line).text().left(KATE_BUFFER_LONG_LINE_WINDOW + KATE_BUFFER_LONG_LINE_WINDOW_MARGIN));
+    bool ctxChanged = false;
+    m_highlight->doHighlight((line >= 1) ? &prevLine : nullptr, &window, ctxChanged);
+
+    // take over the attributes of the window, the highlighting state of the line stays as it is
+    Kate::TextLine &textLine = lineForMetaData(line);
+    textLine.clearAttributes();
+    for (const auto &attribute : window.attributesList()) {
+        if (attribute.offset >= KATE_BUFFER_LONG_LINE_WINDOW) {
+            break;
+        }
+        textLine.addAttribute(
+            Kate::TextLine::Attribute(attribute.offset, qMin(attribute.length, KATE_BUFFER_LONG_LINE_WINDOW - attribute.offset), attribute.attributeValue));
+    }
+    m_windowHighlightedLine = line;
+}
+
+bool KateBuffer::highlightFromCheckpoint(int line, int lookAhead, int maximalDistance)
+{
+    // no hl around, no stuff to do
+    if (!m_highlight || m_highlight->noHighlighting()) {
+        return false;
+    }
+
+    // already highlighted from a checkpoint?
+    if (isCheckpointHighlighted(line)) {
+        return true;
+    }
+
+    // continue the lines highlighted from a checkpoint before or start at the nearest known checkpoint, whatever is closer
+    int startLine = (line >= m_checkpointHighlightedStart) ? m_checkpointHighlightedEnd : -1;
+    const int checkpoints = int(m_highlightingCheckpoints.size());
+    for (int index = qMin(line / KATE_BUFFER_HIGHLIGHTING_CHECKPOINT_LINES, checkpoints) - 1; index >= 0; --index) {
+        const int checkpointLine = (index + 1) * KATE_BUFFER_HIGHLIGHTING_CHECKPOINT_LINES;
+        if (checkpointLine <= qMax(startLine, m_lineHighlighted)) {
+            break;
+        }
+        if (m_highlightingCheckpoints[index] != KSyntaxHighlighting::State()) {
+            startLine = checkpointLine;
+            break;
+        }
+    }
+
+    // nothing better than the highlighted area, the lines need to be highlighted from there
+    if (startLine <= m_lineHighlighted || line - startLine >= maximalDistance) {
+        return false;
+    }
+
+    Kate::TextLine prevLine;
+    if (startLine == m_checkpointHighlightedEnd) {
+        prevLine.setHighlightingState(plainLine(startLine - 1).highlightingState());
+    } else {
+        prevLine.setHighlightingState(m_highlightingCheckpoints[startLine / KATE_BUFFER_HIGHLIGHTING_CHECKPOINT_LINES - 1]);
+        m_checkpointHighlightedStart = startLine;
+    }
+
+    // highlight the lines in place, like doHighlight, they are valid as the state we start with is known
+    const int endLine = qMin(line + lookAhead + 1, lines());
+    for (int currentLine = startLine; currentLine < endLine; ++currentLine) {
+        bool ctxChanged = false;
+        Kate::TextLine &textLine = lineForMetaData(currentLine);
+        m_highlight->doHighlight(&prevLine, &textLine, ctxChanged);
+        shareAttributes(textLine);
+        prevLine.setHighlightingState(textLine.highlightingState());
+    }
+    m_checkpointHighlightedEnd = endLine;
+    return true;
+}
+
+bool KateBuffer::highlightPagedLines(int line, int lookAhead, int maximalDistance)
+{
+    // no hl around, no stuff to do
+    if (!m_highlight || m_highlight->noHighlighting()) {
+        return true;
+    }
+
+    // skip the lines still highlighted
+    const int endLine = qMin(line + lookAhead, lines() - 1);
+    int startLine = line;
+    while (startLine <= endLine && hasPagedMetaDataTag(startLine, m_pagedHighlightingTag)) {
+        ++startLine;
+    }
+    if (startLine > endLine) {
+        return true;
+    }
+
+    // start after the nearest highlighted line or at the nearest known checkpoint, whatever is closer
+    int checkpointLine = 0;
+    for (int index = qMin(startLine / KATE_BUFFER_HIGHLIGHTING_CHECKPOINT_LINES, int(m_highlightingCheckpoints.size())) - 1; index >= 0; --index) {
+        if (m_highlightingCheckpoints[index] != KSyntaxHighlighting::State()) {
+            checkpointLine = (index + 1) * KATE_BUFFER_HIGHLIGHTING_CHECKPOINT_LINES;
+            break;
+        }
+    }
+    while (startLine > checkpointLine && !hasPagedMetaDataTag(startLine - 1, m_pagedHighlightingTag)) {
+        if (line - startLine >= maximalDistance) {
+            return false;
+        }
+        --startLine;
+    }
+    if (line - startLine >= maximalDistance) {
+        return false;
+    }
+
+    Kate::TextLine prevLine;
+    if (startLine > 0 && hasPagedMetaDataTag(startLine - 1, m_pagedHighlightingTag)) {
+        prevLine.setHighlightingState(plainLine(startLine - 1).highlightingState());
+    } else if (startLine > 0) {
+        prevLine.setHighlightingState(m_highlightingCheckpoints[startLine / KATE_BUFFER_HIGHLIGHTING_CHECKPOINT_LINES - 1]);
+    }
+
+    // highlight the lines in place, without pinning their blocks
+    for (int currentLine = startLine; currentLine <= endLine; ++currentLine) {
+        bool ctxChanged = false;
+        Kate::TextLine &textLine = lineForPagedMetaData(currentLine);
+        m_highlight->doHighlight((currentLine >= 1) ? &prevLine : nullptr, &textLine, ctxChanged);
+        shareAttributes(textLine);
+        prevLine.setHighlightingState(textLine.highlightingState());
+        rememberCheckpoint(currentLine, textLine.highlightingState());
+    }
+    setPagedMetaDataTag(startLine, endLine, m_pagedHighlightingTag);
+    return true;
+}
+
+int KateBuffer::knownCheckpoints() const
+{
+    const auto unknown = std::find(m_highlightingCheckpoints.begin(), m_highlightingCheckpoints.end(), KSyntaxHighlighting::State());
+    return int(unknown - m_highlightingCheckpoints.begin());
+}
+
+void KateBuffer::rememberCheckpoint(int line, const KSyntaxHighlighting::State &state)
+{
+    const int index = (line + 1) / KATE_BUFFER_HIGHLIGHTING_CHECKPOINT_LINES - 1;
+    if ((line + 1) % KATE_BUFFER_HIGHLIGHTING_CHECKPOINT_LINES != 0 || index >= lines() / KATE_BUFFER_HIGHLIGHTING_CHECKPOINT_LINES) {
+        return;
+    }
+    if (int(m_highlightingCheckpoints.size()) <= index) {
+        m_highlightingCheckpoints.resize(index + 1);
+    }
+    m_highlightingCheckpoints[index] = state;
+}
+
+void KateBuffer::joinCheckpointHighlightedLines()
+{
+    if (m_checkpointHighlightedStart >= 0 && m_lineHighlighted >= m_checkpointHighlightedStart) {
+        m_lineHighlighted = qMax(m_lineHighlighted, m_checkpointHighlightedEnd);
+        m_checkpointHighlightedStart = m_checkpointHighlightedEnd = -1;
+    }
+}
+
+void KateBuffer::forgetHighlightingAfter(int line)
+{
+    // a checkpoint only depends on the lines before it
+    const size_t validCheckpoints = line / KATE_BUFFER_HIGHLIGHTING_CHECKPOINT_LINES;
+    if (m_highlightingCheckpoints.size() > validCheckpoints) {
+        m_highlightingCheckpoints.resize(validCheckpoints);
+    }
+
+    // the cached highlighting belongs to the text as on disk
+    m_cachedHighlightingEnd = qMin(m_cachedHighlightingEnd, line);
+
+    // the highlighted paged lines are not tracked per line, forget all of them
+    if (isPaged()) {
+        ++m_pagedHighlightingTag;
+    }
+
+    // the window of a long line needs to be highlighted again
+    if (m_windowHighlightedLine >= line) {
+        m_windowHighlightedLine = -1;
+    }
+
+    // lines highlighted from a checkpoint before the change stay valid
+    if (m_checkpointHighlightedStart >= 0) {
+        m_checkpointHighlightedEnd = qMin(m_checkpointHighlightedEnd, line);
+        if (m_checkpointHighlightedEnd <= m_checkpointHighlightedStart) {
+            m_checkpointHighlightedStart = m_checkpointHighlightedEnd = -1;
+        }
+    }
+}
+
+std::vector<KSyntaxHighlighting::State> KateBuffer::highlightingCheckpoints() const
+{
+    // the states of the highlighted lines are known, the checkpoints after them are kept separately
+    std::vector<KSyntaxHighlighting::State> checkpoints = m_highlightingCheckpoints;
+    const int highlightedCheckpoints = qMin(m_lineHighlighted, lines()) / KATE_BUFFER_HIGHLIGHTING_CHECKPOINT_LINES;
+    if (int(checkpoints.size()) < highlightedCheckpoints) {
+        checkpoints.resize(highlightedCheckpoints);
+    }
+    for (int index = 0; index < highlightedCheckpoints; ++index) {
+        checkpoints[index] = line((index + 1) * KATE_BUFFER_HIGHLIGHTING_CHECKPOINT_LINES - 1).highlightingState();
+    }
+    return checkpoints;
+}
+
+void KateBuffer::setHighlightingCheckpoints(std::vector<KSyntaxHighlighting::State> checkpoints)
+{
+    // drop checkpoints outside of the text
+    const size_t maximalCheckpoints = lines() / KATE_BUFFER_HIGHLIGHTING_CHECKPOINT_LINES;
+    if (checkpoints.size() > maximalCheckpoints) {
+        checkpoints.resize(maximalCheckpoints);
+    }
+    m_highlightingCheckpoints = std::move(checkpoints);
+}
+
+void KateBuffer::startBackgroundHighlighting()
+{
+    // one job at a time, the next one is started once the running one did finish
+    if (m_backgroundHighlightingJob) {
+        return;
+    }
+
+    // target reached or nothing to highlight
+    // paged buffers only need the checkpoint before the target, from there the lines are highlighted once painted
+    const bool paged = isPaged();
+    const bool reached = paged ? (knownCheckpoints() >= m_backgroundHighlightingTarget / KATE_BUFFER_HIGHLIGHTING_CHECKPOINT_LINES)
+                               : (m_backgroundHighlightingTarget < m_lineHighlighted);
+    if (reached || !m_highlight || m_highlight->noHighlighting()) {
+        m_backgroundHighlightingTarget = -1;
+        return;
+    }
+
+    // the worker needs its own highlighting, created from the same definition it uses the same attribute indices
+    // and the states of both are interchangeable, a definition of another repository would yield incompatible states
+    // the definition data is shared with the highlighting of the documents, KateHighlighting::doHighlight() never matches
+    // against it on two threads at once, and the repository is not reloaded while a job runs, see stopBackgroundHighlighting()
+    if (!m_backgroundHighlight) {
+        m_backgroundHighlight = std::make_shared<KateHighlighting>(m_highlight->definition());
+    }
+
+    // snapshot the next lines, the worker never touches the buffer
+    auto job = std::make_shared<KateBackgroundHighlightingJob>();
+    job->highlight = m_backgroundHighlight;
+    job->revision = revision();
+    job->generation = m_highlightingGeneration;
+    if (paged) {
+        const int checkpoints = knownCheckpoints();
+        job->startLine = checkpoints * KATE_BUFFER_HIGHLIGHTING_CHECKPOINT_LINES;
+        if (checkpoints > 0) {
+            job->startState = m_highlightingCheckpoints[checkpoints - 1];
+        }
+    } else {
+        job->startLine = m_lineHighlighted;
+        if (job->startLine > 0) {
+            job->startState = plainLine(job->startLine - 1).highlightingState();
+        }
+    }
+    const int endLine = qMin(lines(), job->startLine + KATE_BUFFER_BACKGROUND_HIGHLIGHTING_CHUNK);
+    job->lines.reserve(endLine - job->startLine);
+    for (int line = job->startLine; line < endLine; ++line) {
+        job->lines.emplace_back(Kate::TextBuffer::line(line).text());
+    }
+
+    m_backgroundHighlightingJob = job.get();
+    m_backgroundHighlightingPool.start([this, job]() {
+        Kate::TextLine prevLine;
+        prevLine.setHighlightingState(job->startState);
+        for (auto &textLine : job->lines) {
+            if (m_backgroundHighlightingCancelled) {
+                return;
+            }
+            bool ctxChanged = false;
+            job->highlight->doHighlight(&prevLine, &textLine, ctxChanged);
+            prevLine.setHighlightingState(textLine.highlightingState());
+        }
+
+        // hand the results over to the thread of the buffer, dropped if it is gone meanwhile
+        QMetaObject::invokeMethod(
+            this,
+            [this, job]() {
+                finishBackgroundHighlighting(job);
+            },
+            Qt::QueuedConnection);
+    });
+}
+
+void KateBuffer::stopBackgroundHighlighting()
+{
+    // a job cancelled here never reports back, one that did finish already might have queued its report
+    // that one is ignored by finishBackgroundHighlighting(), it is no longer the running job
+    m_backgroundHighlightingCancelled = true;
+    m_backgroundHighlightingPool.waitForDone();
+    m_backgroundHighlightingCancelled = false;
+    m_backgroundHighlightingJob = nullptr;
+    m_backgroundHighlight.reset();
+    ++m_highlightingGeneration;
+}
+
+void KateBuffer::finishBackgroundHighlighting(const std::shared_ptr<KateBackgroundHighlightingJob> &job)
+{
+    // stale report of a job stopped meanwhile, another job might run already
+    // the address can't be reused by a newer job, the stale one is alive as long as its report
+    if (job.get() != m_backgroundHighlightingJob) {
+        return;
+    }
+    m_backgroundHighlightingJob = nullptr;
+
+    // paged buffers keep only the states at the checkpoints, the lines are highlighted from there once painted
+    const int endLine = job->startLine + int(job->lines.size());
+    if (isPaged()) {
+        if (job->revision == revision() && job->generation == m_highlightingGeneration && editingTransactions() == 0) {
+            for (int line = job->startLine; line < endLine; ++line) {
+                rememberCheckpoint(line, job->lines[line - job->startLine].highlightingState());
+            }
+
+            // the lines waiting for the checkpoints are painted again
+            Q_EMIT tagLines({job->startLine, qMax(endLine - 1, m_backgroundHighlightingTarget)});
+            m_doc->repaintViews(true);
+        }
+        startBackgroundHighlighting();
+        return;
+    }
+
+    // results are only valid for the text and highlighting the snapshot was taken from
+    // else they are dropped and the next job starts from the current state
+    if (job->revision == revision() && job->generation == m_highlightingGeneration && editingTransactions() == 0 && job->startLine <= m_lineHighlighted
+        && m_lineHighlighted < endLine) {
+        // lines before m_lineHighlighted were highlighted synchronously meanwhile, with the same result
+        const int firstLine = m_lineHighlighted;
+        int lastLine = endLine;
+        for (int line = firstLine; line < endLine; ++line) {
+            Kate::TextLine &textLine = lineForMetaData(line);
+            Kate::TextLine &highlightedLine = job->lines[line - job->startLine];
+            const bool ctxChanged = textLine.highlightingState() != highlightedLine.highlightingState();
+            textLine.takeHighlighting(highlightedLine);
+            shareAttributes(textLine);
+
+            // same state as before the last edit, the lines after it are valid, see doHighlight
+            if (!ctxChanged && line + 1 < m_lineHighlightedBeforeEdit) {
+                lastLine = line + 1;
+                m_lineHighlighted = m_lineHighlightedBeforeEdit;
+                break;
+            }
+        }
+        m_lineHighlighted = qMax(m_lineHighlighted, lastLine);
+        if (m_lineHighlighted >= m_lineHighlightedBeforeEdit) {
+            m_lineHighlightedBeforeEdit = 0;
+        }
+        joinCheckpointHighlightedLines();
+
+        // show the new highlighting
+        Q_EMIT tagLines({firstLine, lastLine - 1});
+        m_doc->repaintViews(true);
+    }
+
+    startBackgroundHighlighting();
+}
+
 void KateBuffer::wrapLine(const KTextEditor::Cursor position)
 {
     // call original
@@ -263,6 +924,10 @@ void KateBuffer::wrapLine(const KTextEditor::Cursor position)
     if (m_lineHighlighted > position.line() + 1) {
         m_lineHighlighted++;
     }
+    if (m_lineHighlightedBeforeEdit > position.line() + 1) {
+        m_lineHighlightedBeforeEdit++;
+    }
+    forgetHighlightingAfter(position.line());
 }
 
 void KateBuffer::unwrapLine(int line)
@@ -273,6 +938,10 @@ void KateBuffer::unwrapLine(int line)
     if (m_lineHighlighted > line) {
         --m_lineHighlighted;
     }
+    if (m_lineHighlightedBeforeEdit > line) {
+        --m_lineHighlightedBeforeEdit;
+    }
+    forgetHighlightingAfter(line - 1);
 }
 
 void KateBuffer::setTabWidth(int w)
@@ -300,6 +969,10 @@ void KateBuffer::setHighlight(int hlMode)
 
         m_highlight = h;
 
+        // the background worker needs a new highlighting, too
+        m_backgroundHighlight.reset();
+        ++m_highlightingGeneration;
+
         if (invalidate) {
             invalidateHighlighting();
         }
@@ -308,6 +981,9 @@ void KateBuffer::setHighlight(int hlMode)
         // needed to update attributes and more ;)
         m_doc->bufferHlChanged();
 
+        // the text might have been cached with this highlighting
+        loadHighlightingCache();
+
         // try to set indentation
         if (!h->indentation().isEmpty()) {
             m_doc->config()->setIndentationMode(h->indentation());
@@ -318,12 +994,28 @@ void KateBuffer::setHighlight(int hlMode)
 void KateBuffer::invalidateHighlighting()
 {
     m_lineHighlighted = 0;
+    ++m_highlightingGeneration;
+    ++m_pagedHighlightingTag;
+
+    // no state of any line is known anymore
+    m_lineHighlightedBeforeEdit = 0;
+    m_highlightingCheckpoints.clear();
+    m_checkpointHighlightedStart = m_checkpointHighlightedEnd = -1;
+    m_checkpointsForReloadDigest.clear();
+    m_checkpointsForReload.clear();
+    m_highlightingCache.reset();
+    m_cachedHighlightingEnd = 0;
+    m_cachedHighlightingBlocks.clear();
+    m_windowHighlightedLine = -1;
+    m_sharedAttributes.clear();
+    m_sharedAttributesMemory = 0;
 }
 
 void KateBuffer::doHighlight(int startLine, int endLine, bool invalidate)
 {
     // no hl around, no stuff to do
-    if (!m_highlight || m_highlight->noHighlighting()) {
+    // paged buffers are highlighted per painted lines, the line meta data would keep all blocks in memory, see highlightPagedLines
+    if (!m_highlight || m_highlight->noHighlighting() || isPaged()) {
         return;
     }
 
@@ -334,8 +1026,11 @@ void KateBuffer::doHighlight(int startLine, int endLine, bool invalidate)
     qCDebug(LOG_KTE) << "HL UNTIL LINE: " << m_lineHighlighted;
 #endif
 
-    // if possible get previous line, otherwise create 0 line.
-    Kate::TextLine prevLine = (startLine >= 1) ? plainLine(startLine - 1) : Kate::TextLine();
+    // only the highlighting state of the previous line is used, don't keep a copy of the whole line
+    Kate::TextLine prevLine;
+    if (startLine >= 1) {
+        prevLine.setHighlightingState(plainLine(startLine - 1).highlightingState());
+    }
 
     // here we are atm, start at start line in the block
     int current_line = startLine;
@@ -347,12 +1042,11 @@ void KateBuffer::doHighlight(int startLine, int endLine, bool invalidate)
     for (; current_line < qMin(endLine + 1, lines()); ++current_line) {
         // handle one line
         ctxChanged = false;
-        Kate::TextLine textLine = plainLine(current_line);
+        // highlight the textline stored in the buffer in place, no need to copy its text and attributes
+        Kate::TextLine &textLine = lineForMetaData(current_line);
         m_highlight->doHighlight((current_line >= 1) ? &prevLine : nullptr, &textLine, ctxChanged);
-        prevLine = textLine;
-
-        // write back the computed info to the textline stored in the buffer
-        setLineMetaData(current_line, textLine);
+        shareAttributes(textLine);
+        prevLine.setHighlightingState(textLine.highlightingState());
 
 #ifdef BUFFER_DEBUGGING
         // debug stuff
@@ -373,13 +1067,27 @@ void KateBuffer::doHighlight(int startLine, int endLine, bool invalidate)
         } else if (!stillcontinue && start_spellchecking >= 0) {
             last_line_spellchecking = current_line;
         }
+
+        // the line ends in the same state as before the last edit, the lines after it were highlighted with that state
+        if (!invalidate && !ctxChanged && current_line + 1 < m_lineHighlightedBeforeEdit) {
+            current_line = m_lineHighlightedBeforeEdit;
+            break;
+        }
     }
 
     // perhaps we need to adjust the maximal highlighted line
     int oldHighlighted = m_lineHighlighted;
     if (ctxChanged || current_line > m_lineHighlighted) {
+        // the lines after the changed state are no longer valid, but consistent among each other
+        if (current_line < m_lineHighlighted) {
+            m_lineHighlightedBeforeEdit = m_lineHighlighted;
+        }
         m_lineHighlighted = current_line;
     }
+    if (m_lineHighlighted >= m_lineHighlightedBeforeEdit) {
+        m_lineHighlightedBeforeEdit = 0;
+    }
+    joinCheckpointHighlightedLines();
 
     // tag the changed lines !
     if (invalidate) {
@@ -9,18 +9,64 @@
 #define KATE_BUFFER_H
 
 #include "katehighlight.h"
+#include "katehighlightingcache.h"
 #include "katetextbuffer.h"
 
 #include <ktexteditor_export.h>
 
 #include <QObject>
+#include <QThreadPool>
+
+#include <atomic>
+#include <memory>
 
 class KateLineInfo;
+
+/**
+ * files larger than this are loaded progressively if enabled, see Kate::TextBuffer::setProgressiveLoading
+ */
+static const qint64 KATE_BUFFER_PROGRESSIVE_LOADING_SIZE = 16 * 1024 * 1024;
+
+/**
+ * files larger than this are paged, see Kate::TextBuffer::setPagedLoading
+ * paged documents are read-only, only files too large to be edited in memory anyway are paged
+ */
+static const qint64 KATE_BUFFER_PAGED_LOADING_SIZE = qint64(4) * 1024 * 1024 * 1024;
+
+/**
+ * files larger than this use compact line storage, see Kate::TextBuffer::setCompactLineStorage
+ */
+static const qint64 KATE_BUFFER_COMPACT_STORAGE_SIZE = 4 * 1024 * 1024;
+
+/**
+ * if more lines than this need highlighting before a line can be painted, they are highlighted in the background,
+ * see KateBuffer::ensureHighlightedForPainting
+ */
+static const int KATE_BUFFER_BACKGROUND_HIGHLIGHTING_LINES = 4096;
+
+/**
+ * lines at least this long are not highlighted at once for painting, only their first KATE_BUFFER_LONG_LINE_WINDOW columns,
+ * the whole line is highlighted in the background, see KateBuffer::ensureHighlightedForPainting
+ */
+static const int KATE_BUFFER_LONG_LINE_LENGTH = 256 * 1024;
+
+/**
+ * columns of a long line highlighted at once for painting
+ */
+static const int KATE_BUFFER_LONG_LINE_WINDOW = 64 * 1024;
+
+/**
+ * distance of the highlighting checkpoints, see KateBuffer::highlightingCheckpoints
+ */
+static const int KATE_BUFFER_HIGHLIGHTING_CHECKPOINT_LINES = 1024;
+
 namespace KTextEditor
 {
 class DocumentPrivate;
 }
 
+struct KateBackgroundHighlightingJob;
+
 /**
  * The KateBuffer class maintains a collections of lines.
  *
@@ -105,6 +151,8 @@ public:
 
     /**
      * Open a file, use the given filename
+     * Large files are loaded progressively if enabled by KateDocumentConfig::progressiveLoading(), then isLoading() is still true on return
+     * and fileLoaded() is emitted once the whole file is there.
      * @param m_file filename to open
      * @param enforceTextCodec enforce to use only the set text codec
      * @return success
@@ -182,6 +230,67 @@ public:
      */
     void ensureHighlighted(int line, int lookAhead = 64);
 
+    /**
+     * Like ensureHighlighted(), but for painting.
+     * If many lines before @p line still need highlighting, this is done by a background
+     * worker instead of stalling the caller. Until the results arrive the line keeps its
+     * current, possibly outdated, highlighting, then the lines are tagged and the views repainted.
+     * The same is done for very long lines, only their first columns are highlighted at once.
+     * @param line line to paint
+     * @param lookAhead also highlight these following lines
+     * @return is the line highlighted now?
+     */
+    bool ensureHighlightedForPainting(int line, int lookAhead = 64);
+
+    /**
+     * Is the highlighting of the given line still computed in the background?
+     * @param line line to check
+     * @return highlighting of line pending?
+     */
+    bool isHighlightingPending(int line) const
+    {
+        if (isPaged()) {
+            return m_backgroundHighlightingTarget >= 0 && !hasPagedMetaDataTag(line, m_pagedHighlightingTag);
+        }
+        return m_backgroundHighlightingTarget >= 0 && line >= m_lineHighlighted && !isCheckpointHighlighted(line) && !isCacheHighlighted(line);
+    }
+
+    /**
+     * Abort a running background highlighting job and wait for it, e.g. before the syntax definitions are reloaded.
+     * Its results are dropped, highlighting in the background starts again once lines are painted.
+     */
+    void stopBackgroundHighlighting();
+
+    /**
+     * Memory used by the attribute lists shared among lines, not included in memoryUsage(), see shareAttributes().
+     * @return memory used in bytes
+     */
+    qint64 sharedAttributesMemory() const
+    {
+        return m_sharedAttributesMemory;
+    }
+
+    /**
+     * Remember the highlighting of the text on disk, if the highlighting cache is enabled.
+     * Only done for large texts as on disk that are completely highlighted, see KateHighlightingCache.
+     */
+    void saveHighlightingCache();
+
+    /**
+     * Highlighting states at the start of every KATE_BUFFER_HIGHLIGHTING_CHECKPOINT_LINES-th line,
+     * entry i belongs to line (i + 1) * KATE_BUFFER_HIGHLIGHTING_CHECKPOINT_LINES, a null state is not known.
+     * Highlighting can resume from such a checkpoint instead of highlighting all lines before it.
+     * @return known checkpoints
+     */
+    std::vector<KSyntaxHighlighting::State> highlightingCheckpoints() const;
+
+    /**
+     * Set the highlighting checkpoints, e.g. remembered for the same text before.
+     * They must belong to the current text and highlighting.
+     * @param checkpoints checkpoints as returned by highlightingCheckpoints()
+     */
+    void setHighlightingCheckpoints(std::vector<KSyntaxHighlighting::State> checkpoints);
+
     /**
      * Unwrap given line.
      * @param line line to unwrap
@@ -247,6 +356,80 @@ public:
     findMatchingFoldingMarker(const KTextEditor::Cursor current_cursor_pos, const KSyntaxHighlighting::FoldingRegion foldingRegion, const int maxLines);
 
 private:
+    /**
+     * A progressive load started by openFile finished.
+     * @param encodingErrors were there problems occurred while decoding the file?
+     * @param tooLongLinesWrapped were too long lines found and wrapped?
+     * @param longestLineLoaded the longest line in the file (before wrapping)
+     */
+    KTEXTEDITOR_NO_EXPORT
+    void finishOpenFile(bool encodingErrors, bool tooLongLinesWrapped, int longestLineLoaded);
+
+    /**
+     * Transfer encoding, eol and bom of the loaded file to the document config.
+     */
+    KTEXTEDITOR_NO_EXPORT
+    void applyLoadedFileSettings();
+
+    /**
+     * Take over the checkpoints remembered on clear(), if the same text was loaded again.
+     */
+    KTEXTEDITOR_NO_EXPORT
+    void restoreCheckpointsForReload();
+
+    /**
+     * Can the highlighting of the text be remembered on disk?
+     */
+    KTEXTEDITOR_NO_EXPORT
+    bool canUseHighlightingCache() const;
+
+    /**
+     * Open the highlighting remembered for the text on disk, if the highlighting cache is enabled.
+     */
+    KTEXTEDITOR_NO_EXPORT
+    void loadHighlightingCache();
+
+    /**
+     * Take over the remembered highlighting of the blocks with line up to line + lookAhead.
+     * @param line line to highlight
+     * @param lookAhead also highlight these following lines
+     * @return was the line highlighted?
+     */
+    KTEXTEDITOR_NO_EXPORT
+    bool highlightFromCache(int line, int lookAhead);
+
+    /**
+     * Let the freshly highlighted line share its attributes with equal lines, saves memory for repetitive texts.
+     * @param textLine highlighted line of the buffer
+     */
+    KTEXTEDITOR_NO_EXPORT
+    void shareAttributes(Kate::TextLine &textLine);
+
+    /**
+     * First line of at least KATE_BUFFER_LONG_LINE_LENGTH characters that needs highlighting.
+     * @param startLine first line to check
+     * @param endLine last line to check
+     * @return long line or -1 if none
+     */
+    KTEXTEDITOR_NO_EXPORT
+    int firstLongLine(int startLine, int endLine) const;
+
+    /**
+     * Highlight the first KATE_BUFFER_LONG_LINE_WINDOW columns of a long line for painting.
+     * The line before must be highlighted, the highlighting state of the line itself stays unknown.
+     * @param line long line
+     */
+    KTEXTEDITOR_NO_EXPORT
+    void highlightLongLineWindow(int line);
+
+    /**
+     * Got @p line its highlighting from the highlighting cache?
+     */
+    bool isCacheHighlighted(int line) const
+    {
+        return line < m_cachedHighlightingEnd && m_cachedHighlightingBlocks[line / KATE_HIGHLIGHTING_CACHE_BLOCK_LINES];
+    }
+
     /**
      * Highlight information needs to be updated.
      *
@@ -257,6 +440,79 @@ private:
     KTEXTEDITOR_NO_EXPORT
     void doHighlight(int from, int to, bool invalidate);
 
+    /**
+     * Start highlighting the lines after the highlighted area in the background,
+     * if no job is running and m_backgroundHighlightingTarget is not reached.
+     */
+    KTEXTEDITOR_NO_EXPORT
+    void startBackgroundHighlighting();
+
+    /**
+     * Highlight up to line + lookAhead, starting at the nearest known checkpoint after the highlighted area
+     * or continuing the lines highlighted from a checkpoint before.
+     * @param line line to highlight
+     * @param lookAhead also highlight these following lines
+     * @param maximalDistance don't start further than this before the line
+     * @return was the line highlighted?
+     */
+    KTEXTEDITOR_NO_EXPORT
+    bool highlightFromCheckpoint(int line, int lookAhead, int maximalDistance);
+
+    /**
+     * Highlight the lines of a paged buffer from line to line + lookAhead that are not highlighted already.
+     * Their highlighting is lost once their lines are dropped from memory, therefore the highlighting starts
+     * after the nearest line still highlighted or at the nearest known checkpoint, the checkpoints passed are remembered.
+     * @param line line to highlight
+     * @param lookAhead also highlight these following lines
+     * @param maximalDistance don't start further than this before the line
+     * @return was the line highlighted?
+     */
+    KTEXTEDITOR_NO_EXPORT
+    bool highlightPagedLines(int line, int lookAhead, int maximalDistance);
+
+    /**
+     * Number of checkpoints known from the first one on without a gap, see highlightingCheckpoints().
+     */
+    KTEXTEDITOR_NO_EXPORT
+    int knownCheckpoints() const;
+
+    /**
+     * Remember the highlighting state at the end of @p line, if a checkpoint belongs to the line after it.
+     * @param line highlighted line
+     * @param state highlighting state at the end of the line
+     */
+    KTEXTEDITOR_NO_EXPORT
+    void rememberCheckpoint(int line, const KSyntaxHighlighting::State &state);
+
+    /**
+     * Was @p line highlighted starting at a checkpoint?
+     */
+    bool isCheckpointHighlighted(int line) const
+    {
+        return line >= m_checkpointHighlightedStart && line < m_checkpointHighlightedEnd;
+    }
+
+    /**
+     * The highlighted area did reach the lines highlighted from a checkpoint, include them.
+     */
+    KTEXTEDITOR_NO_EXPORT
+    void joinCheckpointHighlightedLines();
+
+    /**
+     * Forget the highlighting known for the lines after the changed @p line,
+     * that is the checkpoints and the lines highlighted from them.
+     * @param line first changed line
+     */
+    KTEXTEDITOR_NO_EXPORT
+    void forgetHighlightingAfter(int line);
+
+    /**
+     * Take over the results of a background highlighting job, if they are still valid, and start the next one.
+     * @param job finished job
+     */
+    KTEXTEDITOR_NO_EXPORT
+    void finishBackgroundHighlighting(const std::shared_ptr<KateBackgroundHighlightingJob> &job);
+
 Q_SIGNALS:
     /**
      * Emitted when the highlighting of a certain range has
@@ -265,6 +521,11 @@ Q_SIGNALS:
     void tagLines(KTextEditor::LineRange lineRange);
     void respellCheckBlock(int start, int end);
 
+    /**
+     * Emitted when a progressive load started by openFile finished.
+     */
+    void fileLoaded();
+
 private:
     /**
      * document we belong to
@@ -298,6 +559,94 @@ private:
      * last line with valid highlighting
      */
     int m_lineHighlighted;
+
+    /**
+     * incremented each time the highlighting is invalidated without a change of the text,
+     * results of background jobs started before are discarded
+     */
+    quint64 m_highlightingGeneration = 0;
+
+    /**
+     * the lines from m_lineHighlighted up to this one were highlighted one after the other,
+     * before an edit changed the state of a line in front of them
+     * once the line before them ends in the same state as before the edit, they are valid again
+     */
+    int m_lineHighlightedBeforeEdit = 0;
+
+    /**
+     * known highlighting checkpoints after the highlighted area, see highlightingCheckpoints()
+     */
+    std::vector<KSyntaxHighlighting::State> m_highlightingCheckpoints;
+
+    /**
+     * lines after m_lineHighlighted that were highlighted starting at a checkpoint, end is exclusive, -1 if none
+     */
+    int m_checkpointHighlightedStart = -1;
+    int m_checkpointHighlightedEnd = -1;
+
+    /**
+     * paged buffers: the lines marked with this tag are highlighted, see Kate::TextBuffer::setPagedMetaDataTag
+     * incremented once their highlighting is no longer valid, m_lineHighlighted stays 0 for them
+     */
+    quint64 m_pagedHighlightingTag = 1;
+
+    /**
+     * revision of the text as loaded from or saved to disk
+     */
+    qint64 m_revisionOnDisk = -1;
+
+    /**
+     * checkpoints of the text with the given digest, kept on clear() in case the same file is loaded again
+     */
+    QByteArray m_checkpointsForReloadDigest;
+    std::vector<KSyntaxHighlighting::State> m_checkpointsForReload;
+
+    /**
+     * highlighting remembered for the text on disk, if any
+     * the lines before m_cachedHighlightingEnd can take over the highlighting of their cached block,
+     * m_cachedHighlightingBlocks marks the blocks taken over already
+     */
+    std::unique_ptr<KateHighlightingCache> m_highlightingCache;
+    int m_cachedHighlightingEnd = 0;
+    std::vector<bool> m_cachedHighlightingBlocks;
+
+    /**
+     * long line whose first columns are highlighted, see highlightLongLineWindow(), -1 if none
+     */
+    int m_windowHighlightedLine = -1;
+
+    /**
+     * attribute lists shared among lines, see Kate::TextLine::shareAttributes, and the memory used by them
+     */
+    QSet<QList<Kate::TextLine::Attribute>> m_sharedAttributes;
+    qint64 m_sharedAttributesMemory = 0;
+
+    /**
+     * highlighting used by the background worker, a KateHighlighting can't be shared between threads
+     * shared with the running job, the highlighting might change while it runs
+     */
+    std::shared_ptr<KateHighlighting> m_backgroundHighlight;
+
+    /**
+     * the single thread running the background highlighting jobs
+     */
+    QThreadPool m_backgroundHighlightingPool;
+
+    /**
+     * line up to which the background worker shall highlight, -1 if there is nothing to do
+     */
+    int m_backgroundHighlightingTarget = -1;
+
+    /**
+     * the running background highlighting job, nullptr if none
+     * only used to identify the job reporting back, a stale report of a job stopped meanwhile is ignored
+     */
+    const KateBackgroundHighlightingJob *m_backgroundHighlightingJob = nullptr;
+
+    /**
+     * set on destruction and by stopBackgroundHighlighting() to abort a running background highlighting job
+     */
+    std::atomic<bool> m_backgroundHighlightingCancelled = false;
 };
 
 #endif
@@ -204,6 +204,25 @@ KTextEditor::DocumentPrivate::DocumentPrivate(const KPluginMetaData &data, bool
 
     // some nice signals from the buffer
     connect(m_buffer, &KateBuffer::tagLines, this, &KTextEditor::DocumentPrivate::tagLines);
+    connect(m_buffer, &KateBuffer::loadingProgress, this, &KTextEditor::DocumentPrivate::slotBufferLoadingProgress);
+    connect(m_buffer, &KateBuffer::fileLoaded, this, &KTextEditor::DocumentPrivate::slotBufferFileLoaded);
+
+    // a paged file changed while lines were still read from it, that is a modification on disk, too
+    connect(
+        m_buffer,
+        &KateBuffer::pagedFileChanged,
+        this,
+        [this]() {
+            if (!m_modOnHd || m_modOnHdReason != OnDiskModified) {
+                m_modOnHd = true;
+                m_modOnHdReason = OnDiskModified;
+
+                if (!m_modOnHdTimer.isActive()) {
+                    m_modOnHdTimer.start();
+                }
+            }
+        },
+        Qt::QueuedConnection);
 
     // if the user changes the highlight with the dialog, notify the doc
     connect(KateHlManager::self(), &KateHlManager::changed, this, &KTextEditor::DocumentPrivate::internalHlChanged);
@@ -293,6 +312,9 @@ KTextEditor::DocumentPrivate::~DocumentPrivate()
     // any further use of interfaces once they return.
     Q_EMIT aboutToClose(this);
 
+    // remember the highlighting for the next time the file is opened, the buffer is not cleared on destruction
+    m_buffer->saveHighlightingCache();
+
     // remove file from dirwatch
     deactivateDirWatch();
 
@@ -2392,14 +2414,6 @@ bool KTextEditor::DocumentPrivate::openFile()
 
     bool success = m_buffer->openFile(localFilePath(), (m_reloading && m_userSetEncodingForNextReload));
 
-    //
-    // yeah, success
-    // read variables
-    //
-    if (success) {
-        readVariables();
-    }
-
     //
     // update views
     //
@@ -2411,7 +2425,6 @@ bool KTextEditor::DocumentPrivate::openFile()
 
     // Inform that the text has changed (required as we're not inside the usual editStart/End stuff)
     Q_EMIT textChanged(this);
-    Q_EMIT loaded(this);
 
     //
     // to houston, we are not modified
@@ -2423,6 +2436,52 @@ bool KTextEditor::DocumentPrivate::openFile()
         Q_EMIT modifiedOnDisk(this, m_modOnHd, m_modOnHdReason);
     }
 
+    //
+    // progressive loading: the first lines are visible, the rest is appended by the buffer
+    // stay read-only until all lines are there, slotCompleted() will wait for that
+    //
+    if (m_buffer->isLoading()) {
+        setReadWrite(false);
+        QTimer::singleShot(1000, this, SLOT(slotTriggerLoadingMessage()));
+        return success;
+    }
+
+    finishOpenFile(success);
+
+    //
+    // return the success
+    //
+    return success;
+}
+
+void KTextEditor::DocumentPrivate::slotBufferLoadingProgress()
+{
+    // more lines are there, update scrollbars & co.
+    for (auto view : std::as_const(m_views)) {
+        static_cast<ViewPrivate *>(view)->updateView(true);
+    }
+}
+
+void KTextEditor::DocumentPrivate::slotBufferFileLoaded()
+{
+    finishOpenFile(true);
+
+    // the document was read-only during loading, restore the state from before
+    slotCompleted();
+}
+
+void KTextEditor::DocumentPrivate::finishOpenFile(bool success)
+{
+    //
+    // yeah, success
+    // read variables
+    //
+    if (success) {
+        readVariables();
+    }
+
+    Q_EMIT loaded(this);
+
     // Now that we have some text, try to auto detect indent if enabled
     // skip this if for this document already settings were done, either by the user or .e.g. modelines/.kateconfig files.
     if (!isEmpty() && config()->autoDetectIndent() && !config()->isSet(KateDocumentConfig::IndentationWidth)
@@ -2483,10 +2542,19 @@ bool KTextEditor::DocumentPrivate::openFile()
         m_openingError = true;
     }
 
-    //
-    // return the success
-    //
-    return success;
+    // info: huge file, lines are read from disk on demand
+    if (m_buffer->isPaged()) {
+        // the file on disk must stay as it is, it can't be edited or saved, see setReadWrite() and saveFile()
+        setReadWrite(false);
+        m_readWriteStateBeforeLoading = false;
+        QPointer<KTextEditor::Message> message =
+            new KTextEditor::Message(i18n("The file %1 is very large, its lines are read from disk when needed.<br />"
+                                          "It can't be edited or saved.",
+                                          this->url().toDisplayString(QUrl::PreferLocalFile)),
+                                     KTextEditor::Message::Information);
+        message->setWordWrap(true);
+        postMessage(message);
+    }
 }
 
 bool KTextEditor::DocumentPrivate::saveFile()
@@ -2494,6 +2562,14 @@ bool KTextEditor::DocumentPrivate::saveFile()
     // delete pending mod-on-hd message if applicable.
     delete m_modOnHdHandler;
 
+    // lines of paged documents are read from the file on demand, writing it would lose the ones not read yet
+    if (m_buffer->isPaged()) {
+        KMessageBox::error(dialogParent(),
+                           i18n("The document %1 is too large to be saved, its lines are read from the file on disk when needed.",
+                                this->url().toDisplayString(QUrl::PreferLocalFile)));
+        return false;
+    }
+
     // some warnings, if file was changed by the outside!
     if (!url().isEmpty()) {
         if (m_fileChangedDialogsActivated && m_modOnHd) {
@@ -2605,8 +2681,10 @@ bool KTextEditor::DocumentPrivate::saveFile()
         return false;
     }
 
-    // update the checksum
-    createDigest();
+    // update the checksum, if not already done while writing the file
+    if (m_buffer->digest().isEmpty()) {
+        createDigest();
+    }
 
     // add m_file again to dirwatch
     activateDirWatch();
@@ -2904,8 +2982,14 @@ bool KTextEditor::DocumentPrivate::closeUrl()
     // remove all marks
     clearMarks();
 
-    // clear the buffer
+    // clear the buffer, this aborts a running progressive load
+    const bool wasLoading = m_buffer->isLoading();
     m_buffer->clear();
+    if (wasLoading && m_documentState == DocumentLoading) {
+        setReadWrite(m_readWriteStateBeforeLoading);
+        delete m_loadingMessage;
+        m_documentState = DocumentIdle;
+    }
 
     // clear undo/redo history
     m_undoManager->clearUndo();
@@ -2957,6 +3041,11 @@ void KTextEditor::DocumentPrivate::setReadWrite(bool rw)
         return;
     }
 
+    // paged documents stay read-only, they can't be saved, see saveFile()
+    if (rw && m_buffer->isPaged()) {
+        return;
+    }
+
     KParts::ReadWritePart::setReadWrite(rw);
 
     for (auto v : std::as_const(m_views)) {
@@ -5921,6 +6010,12 @@ Kate::TextLine KTextEditor::DocumentPrivate::kateTextLine(int i)
     return m_buffer->plainLine(i);
 }
 
+Kate::TextLine KTextEditor::DocumentPrivate::kateTextLineForPainting(int i)
+{
+    m_buffer->ensureHighlightedForPainting(i);
+    return m_buffer->plainLine(i);
+}
+
 Kate::TextLine KTextEditor::DocumentPrivate::plainKateTextLine(int i)
 {
     return m_buffer->plainLine(i);
@@ -5996,6 +6091,26 @@ void KTextEditor::DocumentPrivate::transformCursor(KTextEditor::Cursor &cursor,
     cursor.setPosition(line, column);
 }
 
+KTextEditor::DocumentPrivate::MemoryUsage KTextEditor::DocumentPrivate::memoryUsage() const
+{
+    const Kate::TextBuffer::MemoryUsage bufferUsage = m_buffer->memoryUsage();
+    MemoryUsage usage;
+    usage.text = bufferUsage.text;
+    usage.attributes = bufferUsage.attributes + m_buffer->sharedAttributesMemory();
+    usage.cursors = bufferUsage.cursors;
+    usage.history = bufferUsage.history;
+    usage.undo = m_undoManager->memoryUsage();
+    return usage;
+}
+
+void KTextEditor::DocumentPrivate::transformCursors(std::span<KTextEditor::Cursor> cursors,
+                                                    KTextEditor::MovingCursor::InsertBehavior insertBehavior,
+                                                    qint64 fromRevision,
+                                                    qint64 toRevision)
+{
+    m_buffer->history().transformCursors(cursors, insertBehavior, fromRevision, toRevision);
+}
+
 void KTextEditor::DocumentPrivate::transformRange(KTextEditor::Range &range,
                                                   KTextEditor::MovingRange::InsertBehaviors insertBehaviors,
                                                   KTextEditor::MovingRange::EmptyBehavior emptyBehavior,
@@ -6097,6 +6212,11 @@ void KTextEditor::DocumentPrivate::slotStarted(KIO::Job *job)
 
 void KTextEditor::DocumentPrivate::slotCompleted()
 {
+    // progressive loading still running, slotBufferFileLoaded will complete the loading
+    if (m_documentState == DocumentLoading && m_buffer->isLoading()) {
+        return;
+    }
+
     // if were loading, reset back to old read-write mode before loading
     // and kill the possible loading message
     if (m_documentState == DocumentLoading) {
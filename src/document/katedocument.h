@@ -661,6 +661,19 @@ public:
     void
     transformCursor(int &line, int &column, KTextEditor::MovingCursor::InsertBehavior insertBehavior, qint64 fromRevision, qint64 toRevision = -1) override;
 
+    /**
+     * Transform many cursors from one revision to an other, faster than calling transformCursor() for each of them.
+     * Implements KTextEditor::Document::transformCursors().
+     * @param cursors cursors to transform
+     * @param insertBehavior behavior of the cursors on insert of text at their position
+     * @param fromRevision from this revision we want to transform
+     * @param toRevision to this revision we want to transform, default of -1 is current revision
+     */
+    void transformCursors(std::span<KTextEditor::Cursor> cursors,
+                          KTextEditor::MovingCursor::InsertBehavior insertBehavior,
+                          qint64 fromRevision,
+                          qint64 toRevision = -1);
+
     /**
      * Transform a range from one revision to an other.
      * @param range range to transform
@@ -1022,6 +1035,12 @@ public:
      */
     Kate::TextLine kateTextLine(int i);
 
+    /**
+     * Same as kateTextLine(), but for painting, far away lines are highlighted in
+     * the background, see KateBuffer::ensureHighlightedForPainting().
+     */
+    Kate::TextLine kateTextLineForPainting(int i);
+
     //! @copydoc KateBuffer::plainLine()
     Kate::TextLine plainKateTextLine(int i);
 
@@ -1090,6 +1109,43 @@ public:
         return *m_buffer;
     }
 
+    /**
+     * Memory used by the document, in bytes.
+     * Values are computed from container sizes, see Kate::TextBuffer::memoryUsage() for what is counted again on each call.
+     */
+    struct MemoryUsage {
+        /**
+         * text of all lines, including the block structure of the buffer
+         */
+        qint64 text = 0;
+
+        /**
+         * highlighting attributes of all lines
+         */
+        qint64 attributes = 0;
+
+        /**
+         * moving cursors and ranges
+         */
+        qint64 cursors = 0;
+
+        /**
+         * undo and redo groups
+         */
+        qint64 undo = 0;
+
+        /**
+         * revision history entries
+         */
+        qint64 history = 0;
+    };
+
+    /**
+     * Memory accounting for this document, view specific data is available via KTextEditor::ViewPrivate::memoryUsage().
+     * @return memory used by this document
+     */
+    MemoryUsage memoryUsage() const;
+
     /**
      * set indentation mode by user
      * this will remember that a user did set it and will avoid reset on save
@@ -1346,6 +1402,16 @@ private Q_SLOTS:
      */
     void slotAbortLoading();
 
+    /**
+     * progressive loading appended lines to the buffer, update the views
+     */
+    void slotBufferLoadingProgress();
+
+    /**
+     * progressive loading is done, complete what openFile did leave out
+     */
+    void slotBufferFileLoaded();
+
     void slotUrlChanged(const QUrl &url);
 
 private:
@@ -1422,6 +1488,13 @@ public:
 public Q_SLOTS:
     void openWithLineLengthLimitOverride();
 
+private:
+    /**
+     * Second part of openFile, done once all lines are loaded: read variables, detect indentation, show errors.
+     * @param success did the loading work?
+     */
+    void finishOpenFile(bool success);
+
 private:
     /**
      * timer for delayed handling of mod on hd
@@ -0,0 +1,269 @@
+/*
+    SPDX-FileCopyrightText: 2026 KTextEditor contributors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "katehighlightingcache.h"
+#include "kateglobal.h"
+#include "katepartdebug.h"
+#include "katetextbuffer.h"
+
+#include <KSyntaxHighlighting/Definition>
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QThreadPool>
+#include <QtEndian>
+
+#include <cstring>
+
+/**
+ * start of each cache file, change it if the format or the meaning of the attributes changes
+ */
+static const char cacheFileMagic[] = "KTextEditor Highlighting Cache 1\n";
+
+/**
+ * size of the header before the block index: magic, lines, lines per block, blocks
+ */
+static const qint64 cacheFileHeaderSize = sizeof(cacheFileMagic) - 1 + 3 * sizeof(quint32);
+
+/**
+ * folding flags of a line in the cache file
+ */
+static const quint32 cachedFoldingStart = 1;
+static const quint32 cachedFoldingEnd = 2;
+
+namespace
+{
+// numbers are stored with 7 bits per byte, the high bit marks that more bytes follow
+void writeNumber(QByteArray &data, quint32 value)
+{
+    while (value >= 0x80) {
+        data.append(char((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    data.append(char(value));
+}
+
+bool readNumber(const uchar *&data, const uchar *end, quint32 &value)
+{
+    value = 0;
+    for (int shift = 0; shift < 32 && data < end; shift += 7) {
+        const uchar byte = *data++;
+        value |= quint32(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// offsets are stored relative to the previous attribute, they should ascend, but we don't rely on that
+quint32 encodeDistance(int distance)
+{
+    return (quint32(distance) << 1) ^ quint32(distance >> 31);
+}
+
+int decodeDistance(quint32 value)
+{
+    return int(value >> 1) ^ -int(value & 1);
+}
+}
+
+QString KateHighlightingCache::fileName(const QByteArray &digest, const KSyntaxHighlighting::Definition &definition)
+{
+    // the attribute values depend on the definition and all definitions it includes
+    QCryptographicHash key(QCryptographicHash::Sha1);
+    key.addData(QByteArrayView(cacheFileMagic, sizeof(cacheFileMagic) - 1));
+    key.addData(digest);
+    key.addData(definition.name().toUtf8());
+    key.addData(QByteArray::number(definition.version()));
+    const auto includedDefinitions = definition.includedDefinitions();
+    for (const auto &includedDefinition : includedDefinitions) {
+        key.addData(includedDefinition.name().toUtf8());
+        key.addData(QByteArray::number(includedDefinition.version()));
+    }
+
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/katehighlighting/")
+        + QString::fromLatin1(key.result().toHex());
+}
+
+void KateHighlightingCache::write(const QString &fileName, const Kate::TextBuffer &buffer)
+{
+    // take the attributes and folding flags, the attribute lists are shared with the lines, no text is copied
+    const int lines = buffer.lines();
+    std::vector<CachedLine> cachedLines(lines);
+    for (int line = 0; line < lines; ++line) {
+        const Kate::TextLine textLine = buffer.line(line);
+        cachedLines[line].attributes = textLine.attributesList();
+        cachedLines[line].flags =
+            (textLine.markedAsFoldingStartAttribute() ? cachedFoldingStart : 0) | (textLine.markedAsFoldingEndAttribute() ? cachedFoldingEnd : 0);
+    }
+
+    // encode and write the file in the background, e.g. the document closing doesn't wait for it
+    writePool().start([fileName, cachedLines = std::move(cachedLines)]() {
+        writeFile(fileName, cachedLines);
+    });
+}
+
+void KateHighlightingCache::waitForWritten()
+{
+    writePool().waitForDone();
+}
+
+QThreadPool &KateHighlightingCache::writePool()
+{
+    return *KTextEditor::EditorPrivate::self()->highlightingCacheWritePool();
+}
+
+bool KateHighlightingCache::writeFile(const QString &fileName, const std::vector<CachedLine> &cachedLines)
+{
+    // encode the lines block by block, remember where each block ends
+    const int lines = int(cachedLines.size());
+    const int blocks = (lines + KATE_HIGHLIGHTING_CACHE_BLOCK_LINES - 1) / KATE_HIGHLIGHTING_CACHE_BLOCK_LINES;
+    QByteArray data;
+    QByteArray index;
+    for (int line = 0; line < lines; ++line) {
+        const QList<Kate::TextLine::Attribute> &attributes = cachedLines[line].attributes;
+        writeNumber(data, cachedLines[line].flags);
+        writeNumber(data, quint32(attributes.size()));
+        int previousOffset = 0;
+        for (const auto &attribute : attributes) {
+            writeNumber(data, encodeDistance(attribute.offset - previousOffset));
+            writeNumber(data, quint32(attribute.length));
+            writeNumber(data, quint32(attribute.attributeValue));
+            previousOffset = attribute.offset;
+        }
+
+        if ((line + 1) % KATE_HIGHLIGHTING_CACHE_BLOCK_LINES == 0 || line + 1 == lines) {
+            char end[sizeof(quint64)];
+            qToLittleEndian<quint64>(data.size(), end);
+            index.append(end, sizeof(end));
+        }
+    }
+
+    char header[3 * sizeof(quint32)];
+    qToLittleEndian<quint32>(lines, header);
+    qToLittleEndian<quint32>(KATE_HIGHLIGHTING_CACHE_BLOCK_LINES, header + sizeof(quint32));
+    qToLittleEndian<quint32>(blocks, header + 2 * sizeof(quint32));
+
+    // write the file atomically, a reader never sees a partial one
+    const QFileInfo info(fileName);
+    if (!QDir().mkpath(info.absolutePath())) {
+        return false;
+    }
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    file.write(cacheFileMagic, sizeof(cacheFileMagic) - 1);
+    file.write(header, sizeof(header));
+    file.write(index);
+    file.write(data);
+    if (!file.commit()) {
+        qCWarning(LOG_KTE) << "Can't write highlighting cache file:" << fileName;
+        return false;
+    }
+
+    // limit the size of the cache, drop the least recently used files
+    const QFileInfoList files = QDir(info.absolutePath()).entryInfoList(QDir::Files, QDir::Time);
+    for (int i = KATE_HIGHLIGHTING_CACHE_MAXIMAL_FILES; i < files.size(); ++i) {
+        QFile::remove(files[i].absoluteFilePath());
+    }
+    return true;
+}
+
+bool KateHighlightingCache::open(const QString &fileName, int lines)
+{
+    m_file.setFileName(fileName);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    // the lines are read from the mapped file on demand
+    m_size = m_file.size();
+    if (m_size < cacheFileHeaderSize || !(m_data = m_file.map(0, m_size))) {
+        return false;
+    }
+
+    // the file must fit the text and this format
+    const uchar *header = m_data + sizeof(cacheFileMagic) - 1;
+    const int blocks = (lines + KATE_HIGHLIGHTING_CACHE_BLOCK_LINES - 1) / KATE_HIGHLIGHTING_CACHE_BLOCK_LINES;
+    if (std::memcmp(m_data, cacheFileMagic, sizeof(cacheFileMagic) - 1) != 0 || qFromLittleEndian<quint32>(header) != quint32(lines)
+        || qFromLittleEndian<quint32>(header + sizeof(quint32)) != quint32(KATE_HIGHLIGHTING_CACHE_BLOCK_LINES)
+        || qFromLittleEndian<quint32>(header + 2 * sizeof(quint32)) != quint32(blocks)) {
+        return false;
+    }
+
+    // read the block index, the blocks must be inside of the file
+    m_blocksStart = cacheFileHeaderSize + blocks * qint64(sizeof(quint64));
+    if (m_size < m_blocksStart) {
+        return false;
+    }
+    m_blockEnds.reserve(blocks);
+    qint64 previousEnd = 0;
+    for (int block = 0; block < blocks; ++block) {
+        const qint64 end = qFromLittleEndian<quint64>(m_data + cacheFileHeaderSize + block * sizeof(quint64));
+        if (end < previousEnd || end > m_size - m_blocksStart) {
+            m_blockEnds.clear();
+            return false;
+        }
+        m_blockEnds.push_back(end);
+        previousEnd = end;
+    }
+
+    // mark the file as used recently, see write()
+    m_file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+    m_lines = lines;
+    return true;
+}
+
+bool KateHighlightingCache::readBlock(int block, const Kate::TextBuffer &buffer, int formats, std::vector<Kate::TextLine> &lines) const
+{
+    if (block < 0 || block >= blocks()) {
+        return false;
+    }
+
+    const uchar *data = m_data + m_blocksStart + ((block > 0) ? m_blockEnds[block - 1] : 0);
+    const uchar *end = m_data + m_blocksStart + m_blockEnds[block];
+    lines.clear();
+    const int firstLine = block * KATE_HIGHLIGHTING_CACHE_BLOCK_LINES;
+    lines.resize(qMin(KATE_HIGHLIGHTING_CACHE_BLOCK_LINES, m_lines - firstLine));
+    for (size_t i = 0; i < lines.size(); ++i) {
+        Kate::TextLine &textLine = lines[i];
+        const qint64 lineLength = buffer.lineLength(firstLine + int(i));
+        quint32 flags = 0;
+        quint32 attributes = 0;
+        if (!readNumber(data, end, flags) || !readNumber(data, end, attributes)) {
+            return false;
+        }
+        if (flags & cachedFoldingStart) {
+            textLine.markAsFoldingStartAttribute();
+        }
+        if (flags & cachedFoldingEnd) {
+            textLine.markAsFoldingEndAttribute();
+        }
+
+        // the attributes must lie within the line and belong to the highlighting, else the file is broken
+        qint64 offset = 0;
+        for (quint32 attribute = 0; attribute < attributes; ++attribute) {
+            quint32 distance = 0;
+            quint32 length = 0;
+            quint32 attributeValue = 0;
+            if (!readNumber(data, end, distance) || !readNumber(data, end, length) || !readNumber(data, end, attributeValue)) {
+                return false;
+            }
+            offset += decodeDistance(distance);
+            if (offset < 0 || offset + length > lineLength || attributeValue >= quint32(formats)) {
+                return false;
+            }
+            textLine.addAttribute(Kate::TextLine::Attribute(int(offset), int(length), int(attributeValue)));
+        }
+    }
+    return data == end;
+}
@@ -0,0 +1,136 @@
+/*
+    SPDX-FileCopyrightText: 2026 KTextEditor contributors
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef KATE_HIGHLIGHTING_CACHE_H
+#define KATE_HIGHLIGHTING_CACHE_H
+
+#include "katetextline.h"
+
+#include <QByteArray>
+#include <QFile>
+
+#include <vector>
+
+namespace Kate
+{
+class TextBuffer;
+}
+
+namespace KSyntaxHighlighting
+{
+class Definition;
+}
+
+/**
+ * lines per block of a highlighting cache file, a block is read at once
+ */
+static const int KATE_HIGHLIGHTING_CACHE_BLOCK_LINES = 1024;
+
+/**
+ * maximal number of files kept in the highlighting cache directory, the least recently used ones are removed
+ */
+static const int KATE_HIGHLIGHTING_CACHE_MAXIMAL_FILES = 64;
+
+/**
+ * The highlighting of a text remembered on disk: the attributes and folding flags of all lines.
+ * The files are keyed by the digest of the text and the syntax definition, so they are only found
+ * again for the very same text highlighted by the very same definition.
+ *
+ * The highlighting states can't be stored, therefore lines read from the cache can be painted,
+ * but highlighting the following lines still needs to start at the last really highlighted one.
+ */
+class KateHighlightingCache
+{
+public:
+    /**
+     * File of the cache entry for the given text and definition.
+     * @param digest digest of the text, see Kate::TextBuffer::digest()
+     * @param definition syntax definition used to highlight the text
+     * @return absolute file name
+     */
+    static QString fileName(const QByteArray &digest, const KSyntaxHighlighting::Definition &definition);
+
+    /**
+     * Store the highlighting of all lines of the buffer.
+     * Only the attributes are taken from the buffer at once, the file is encoded and written in the background.
+     * @param fileName file to write, see fileName()
+     * @param buffer highlighted buffer
+     */
+    static void write(const QString &fileName, const Kate::TextBuffer &buffer);
+
+    /**
+     * Wait until all files passed to write() are written.
+     */
+    static void waitForWritten();
+
+    /**
+     * Open a cache file, only the header is read, the lines are read per block on demand.
+     * @param fileName file to read, see fileName()
+     * @param lines number of lines the cached text must have
+     * @return success, false if the file doesn't exist or doesn't fit
+     */
+    bool open(const QString &fileName, int lines);
+
+    /**
+     * Read the highlighting of the lines of one block.
+     * @param block block to read, the lines from block * KATE_HIGHLIGHTING_CACHE_BLOCK_LINES on
+     * @param buffer text of the cache, the attributes must lie within its lines
+     * @param formats number of formats of the highlighting, the attribute values must be smaller
+     * @param lines lines without text that get the attributes and folding flags of the block
+     * @return success, false if the file is broken
+     */
+    bool readBlock(int block, const Kate::TextBuffer &buffer, int formats, std::vector<Kate::TextLine> &lines) const;
+
+    /**
+     * Number of blocks of the opened file.
+     */
+    int blocks() const
+    {
+        return int(m_blockEnds.size());
+    }
+
+private:
+    /**
+     * highlighting of one line to write, see write()
+     */
+    struct CachedLine {
+        QList<Kate::TextLine::Attribute> attributes;
+        quint32 flags = 0;
+    };
+
+    /**
+     * Encode the lines and write them to the given file.
+     * @param fileName file to write
+     * @param cachedLines highlighting of all lines
+     * @return success
+     */
+    static bool writeFile(const QString &fileName, const std::vector<CachedLine> &cachedLines);
+
+    /**
+     * the single thread writing the files, owned by KTextEditor::EditorPrivate
+     */
+    static QThreadPool &writePool();
+
+    /**
+     * opened file and its mapped content
+     */
+    QFile m_file;
+    const uchar *m_data = nullptr;
+    qint64 m_size = 0;
+
+    /**
+     * number of cached lines
+     */
+    int m_lines = 0;
+
+    /**
+     * offset of the first block in the file and end offsets of all blocks
+     */
+    qint64 m_blocksStart = 0;
+    std::vector<qint64> m_blockEnds;
+};
+
+#endif
@@ -21,6 +21,7 @@
 
 // the list of views
 #include <QList>
+#include <QSpan>
 
 class KConfigGroup;
 
@@ -1584,6 +1585,26 @@ public:
                                 qint64 fromRevision,
                                 qint64 toRevision = -1) = 0;
 
+    /*!
+     * Transform many cursors from one revision to an other.
+     * Gives the same results as transformCursor() for each cursor, but is
+     * faster, as each change between the revisions is only looked at once.
+     *
+     *  cursors are the cursors to transform
+     *
+     *  insertBehavior is the behavior of the cursors on insert of text at their position
+     *
+     *  fromRevision is the first revision to transform
+     *
+     *  toRevision is the last revision to transform (default of -1 is current revision)
+     *
+     * \since 6.30
+     */
+    void transformCursors(QSpan<KTextEditor::Cursor> cursors,
+                          KTextEditor::MovingCursor::InsertBehavior insertBehavior,
+                          qint64 fromRevision,
+                          qint64 toRevision = -1);
+
 Q_SIGNALS:
 
 #if KTEXTEDITOR_ENABLE_DEPRECATED_SINCE(6, 9)
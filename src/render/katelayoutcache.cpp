@@ -27,6 +27,10 @@ bool lessThan2(int line, KateLineLayout *lhs)
 {
     return line < lhs->line();
 }
+
+// rough size of the glyph data QTextLayout keeps per character and per laid out line
+constexpr qint64 layoutBytesPerCharacter = 24;
+constexpr qint64 layoutBytesPerLine = 64;
 }
 
 // BEGIN KateLineLayoutMap
@@ -106,6 +110,17 @@ void KateLineLayoutMap::slotEditDone(KateRenderer *renderer, int fromLine, int t
     }
 }
 
+qint64 KateLineLayoutMap::memoryUsage() const
+{
+    qint64 bytes = m_lineLayouts.capacity() * sizeof(KateLineLayout *);
+    for (const KateLineLayout *l : m_lineLayouts) {
+        const QTextLayout &layout = l->layout();
+        bytes += sizeof(KateLineLayout) + layout.text().size() * (sizeof(QChar) + layoutBytesPerCharacter) + layout.lineCount() * layoutBytesPerLine
+            + layout.formats().size() * sizeof(QTextLayout::FormatRange);
+    }
+    return bytes;
+}
+
 KateLineLayout *KateLineLayoutMap::find(int i)
 {
     const auto it = std::lower_bound(m_lineLayouts.begin(), m_lineLayouts.end(), i, lessThan);
@@ -250,7 +265,7 @@ KateLineLayout *KateLayoutCache::line(int realLine, int virtualLine)
             l->setVirtualLine(virtualLine);
         }
 
-        const Kate::TextLine textLine = acceptDirtyLayouts() ? m_renderer->doc()->plainKateTextLine(l->line()) : m_renderer->doc()->kateTextLine(l->line());
+        const Kate::TextLine textLine = acceptDirtyLayouts() ? m_renderer->doc()->plainKateTextLine(l->line()) : m_renderer->doc()->kateTextLineForPainting(l->line());
 
         if (l->layout().lineCount() <= 0) {
             m_renderer->layoutLine(textLine, l, wrap() ? m_viewWidth : -1, enableLayoutCache);
@@ -273,7 +288,7 @@ KateLineLayout *KateLayoutCache::line(int realLine, int virtualLine)
     l->setLine(m_renderer->folding(), realLine, virtualLine);
 
     // because it may not have the syntax highlighting applied, allow layoutLine to use plainLines...
-    const Kate::TextLine textLine = acceptDirtyLayouts() ? m_renderer->doc()->plainKateTextLine(l->line()) : m_renderer->doc()->kateTextLine(l->line());
+    const Kate::TextLine textLine = acceptDirtyLayouts() ? m_renderer->doc()->plainKateTextLine(l->line()) : m_renderer->doc()->kateTextLineForPainting(l->line());
     m_renderer->layoutLine(textLine, l, wrap() ? m_viewWidth : -1, enableLayoutCache);
     Q_ASSERT(l->isValid());
 
@@ -480,6 +495,11 @@ void KateLayoutCache::clear()
     m_startPos = KTextEditor::Cursor(-1, -1);
 }
 
+qint64 KateLayoutCache::memoryUsage() const
+{
+    return m_lineLayouts.memoryUsage() + m_textLayouts.capacity() * sizeof(KateTextLayout);
+}
+
 void KateLayoutCache::setViewWidth(int width)
 {
     m_viewWidth = width;
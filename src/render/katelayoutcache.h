@@ -32,6 +32,8 @@ public:
 
     KateLineLayout *find(int i);
 
+    qint64 memoryUsage() const;
+
 private:
     std::vector<KateLineLayout *> m_lineLayouts;
     std::pmr::unsynchronized_pool_resource &m_allocator;
@@ -59,6 +61,12 @@ public:
 
     void clear();
 
+    /**
+     * Estimated memory used by the cached layouts.
+     * QTextLayout doesn't expose the size of its glyph data, it is approximated per character and line.
+     */
+    qint64 memoryUsage() const;
+
     int viewWidth() const;
     void setViewWidth(int width);
 
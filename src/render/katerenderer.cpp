@@ -417,9 +417,6 @@ QList<QTextLayout::FormatRange> KateRenderer::decorationsForLine(const Kate::Tex
     // limit number of attributes we can highlight in reasonable time
     const int limitOfRanges = 1024;
     auto rangesWithAttributes = m_doc->buffer().rangesForLine(line, m_printerFriendly ? nullptr : m_view, true);
-    if (rangesWithAttributes.size() > limitOfRanges) {
-        rangesWithAttributes.clear();
-    }
 
     // Don't compute the highlighting if there isn't going to be any highlighting
     const auto &al = textLine.attributesList();
@@ -645,7 +642,7 @@ void KateRenderer::paintTextLine(QPainter &paint,
 
     // font data
     const QFontMetricsF &fm = m_fontMetrics;
-    const Kate::TextLine textLine = doc()->kateTextLine(range->line());
+    const Kate::TextLine textLine = doc()->kateTextLineForPainting(range->line());
 
     int currentViewLine = -1;
     if (cursor && cursor->line() == range->line() && m_view && m_view->isHighlightCurrentLineActive()) {
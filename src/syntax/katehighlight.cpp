@@ -16,11 +16,24 @@
 #include "katedocument.h"
 #include "kateextendedattribute.h"
 #include "katesyntaxmanager.h"
+
+#include <QMutex>
 // END
 
+/**
+ * Serializes the matching of all highlightings and the loading of their definitions.
+ * The highlighting of the background worker uses the same definition data as the one of the documents,
+ * see KateBuffer::startBackgroundHighlighting(), and that data is not meant to be used by two threads at once.
+ * Definitions include each other, therefore one lock for all of them.
+ */
+static QMutex s_highlightLineMutex;
+
 // BEGIN KateHighlighting
 KateHighlighting::KateHighlighting(const KSyntaxHighlighting::Definition &def)
 {
+    // loading the definitions below modifies their data, the background worker might use some of them meanwhile
+    QMutexLocker locker(&s_highlightLineMutex);
+
     // get name and section, always works
     iName = def.name();
     iSection = def.translatedSection();
@@ -147,7 +160,12 @@ void KateHighlighting::doHighlight(const Kate::TextLine *prevLine, Kate::TextLin
     m_textLineToHighlight = textLine;
     m_foldings = foldings;
     const KSyntaxHighlighting::State initialState(!prevLine ? KSyntaxHighlighting::State() : prevLine->highlightingState());
-    const KSyntaxHighlighting::State endOfLineState = highlightLine(textLine->text(), initialState);
+    KSyntaxHighlighting::State endOfLineState;
+    {
+        // uncontended unless the background worker highlights a line right now
+        QMutexLocker locker(&s_highlightLineMutex);
+        endOfLineState = highlightLine(textLine->text(), initialState);
+    }
     m_textLineToHighlight = nullptr;
     m_foldings = nullptr;
 
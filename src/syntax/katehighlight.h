@@ -275,6 +275,11 @@ public:
      */
     QList<KTextEditor::Attribute::Ptr> attributesForDefinition(const QString &schema) const;
 
+    /**
+     * Definition this highlighting was created for.
+     */
+    using KSyntaxHighlighting::AbstractHighlighter::definition;
+
     /**
      * Retrieve all formats for this highlighting.
      * @return all formats for the highlighting definition of this highlighting includes included formats
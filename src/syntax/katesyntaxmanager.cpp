@@ -72,6 +72,12 @@ void KateHlManager::reload()
     std::unordered_map<QString, std::unique_ptr<KateHighlighting>> keepHighlighingsAlive;
     keepHighlighingsAlive.swap(m_hlDict);
 
+    // background highlighting reads the definitions of the repository, it must not run while they are replaced
+    const auto docs = KTextEditor::EditorPrivate::self()->documents();
+    for (auto doc : docs) {
+        static_cast<KTextEditor::DocumentPrivate *>(doc)->buffer().stopBackgroundHighlighting();
+    }
+
     // recreate repository
     // this might even remove highlighting modes known before
     m_repository.reload();
@@ -79,7 +85,6 @@ void KateHlManager::reload()
     // let all documents use the new highlighters
     // will be created on demand
     // if old hl not found, use none
-    const auto docs = KTextEditor::EditorPrivate::self()->documents();
     for (auto doc : docs) {
         auto hlMode = doc->highlightingMode();
         if (nameFind(hlMode) < 0) {
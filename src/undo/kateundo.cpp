@@ -255,6 +255,16 @@ void KateUndoGroup::safePoint(bool safePoint)
     m_safePoint = safePoint;
 }
 
+qint64 KateUndoGroup::memoryUsage() const
+{
+    qint64 bytes = sizeof(KateUndoGroup) + m_items.capacity() * sizeof(UndoItem);
+    for (const UndoItem &item : m_items) {
+        bytes += item.text.capacity() * sizeof(QChar);
+    }
+    bytes += (m_undoSecondaryCursors.capacity() + m_redoSecondaryCursors.capacity()) * sizeof(KTextEditor::ViewPrivate::PlainSecondaryCursor);
+    return bytes;
+}
+
 void KateUndoGroup::flagSavedAsModified()
 {
     for (UndoItem &item : m_items) {
@@ -122,6 +122,12 @@ public:
      */
     void flagSavedAsModified();
 
+    /**
+     * Memory used by this group, including its items and their text.
+     * @return bytes used
+     */
+    qint64 memoryUsage() const;
+
     void markUndoAsSaved(QBitArray &lines);
     void markRedoAsSaved(QBitArray &lines);
 
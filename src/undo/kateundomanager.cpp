@@ -372,6 +372,21 @@ uint KateUndoManager::redoCount() const
     return static_cast<uint>(redoItems.size());
 }
 
+qint64 KateUndoManager::memoryUsage() const
+{
+    // the vectors store the groups, don't count them twice
+    qint64 bytes = (undoItems.capacity() + redoItems.capacity() + savedUndoItems.capacity() + savedRedoItems.capacity()) * sizeof(KateUndoGroup);
+    for (const auto *groups : {&undoItems, &redoItems, &savedUndoItems, &savedRedoItems}) {
+        for (const KateUndoGroup &group : *groups) {
+            bytes += group.memoryUsage() - qint64(sizeof(KateUndoGroup));
+        }
+    }
+    if (m_editCurrentUndo) {
+        bytes += m_editCurrentUndo->memoryUsage();
+    }
+    return bytes;
+}
+
 void KateUndoManager::undo()
 {
     Q_ASSERT(!m_editCurrentUndo.has_value()); // undo is not supported while we care about notifications (call editEnd() first)
@@ -71,6 +71,12 @@ public:
      */
     uint redoCount() const;
 
+    /**
+     * Memory used by all undo and redo groups, including the ones kept over a reload.
+     * @return bytes used
+     */
+    qint64 memoryUsage() const;
+
     /**
      * Prevent latest KateUndoGroup from being merged with the next one.
      */
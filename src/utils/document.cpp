@@ -87,6 +87,14 @@ QUrl Document::getSaveFileUrl(const QString &dialogTitle, QWidget *parent)
     return d->getSaveFileUrl(dialogTitle, parent);
 }
 
+void Document::transformCursors(QSpan<KTextEditor::Cursor> cursors,
+                                KTextEditor::MovingCursor::InsertBehavior insertBehavior,
+                                qint64 fromRevision,
+                                qint64 toRevision)
+{
+    d->transformCursors(std::span<KTextEditor::Cursor>(cursors.data(), cursors.size()), insertBehavior, fromRevision, toRevision);
+}
+
 bool KTextEditor::Document::replaceText(Range range, const QString &text, bool block)
 {
     bool success = true;
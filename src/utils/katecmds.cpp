@@ -20,6 +20,7 @@
 
 #include <QCollator>
 #include <QDateTime>
+#include <QLocale>
 #include <QRegularExpression>
 
 // BEGIN CoreCommands
@@ -198,6 +199,12 @@ bool KateCommands::CoreCommands::help(KTextEditor::View *, const QString &cmd, Q
     } else if (realcmd == QLatin1String("print")) {
         msg = i18n("<p>Open the Print dialog to print the current document.</p>");
         return true;
+    } else if (realcmd == QLatin1String("memstats")) {
+        msg = i18n(
+            "<p>Show the memory used by the current document and view.</p>"
+            "<p>Reports the text, highlighting attributes, moving cursors and ranges, undo history, revision history, "
+            "folding ranges, layout cache and minimap.</p>");
+        return true;
     } else {
         return false;
     }
@@ -305,6 +312,23 @@ bool KateCommands::CoreCommands::exec(KTextEditor::View *view, const QString &_c
     } else if (cmd == QLatin1String("print")) {
         v->print();
         return true;
+    } else if (cmd == QLatin1String("memstats")) {
+        const auto docUsage = v->doc()->memoryUsage();
+        const auto viewUsage = v->memoryUsage();
+        const QLocale locale = QLocale::system();
+        const qint64 total = docUsage.text + docUsage.attributes + docUsage.cursors + docUsage.undo + docUsage.history + viewUsage.folding
+            + viewUsage.layoutCache + viewUsage.miniMap;
+        errorMsg = i18n("text %1, attributes %2, cursors %3, undo %4, history %5, folding %6, layout cache %7, minimap %8, total %9",
+                        locale.formattedDataSize(docUsage.text),
+                        locale.formattedDataSize(docUsage.attributes),
+                        locale.formattedDataSize(docUsage.cursors),
+                        locale.formattedDataSize(docUsage.undo),
+                        locale.formattedDataSize(docUsage.history),
+                        locale.formattedDataSize(viewUsage.folding),
+                        locale.formattedDataSize(viewUsage.layoutCache),
+                        locale.formattedDataSize(viewUsage.miniMap),
+                        locale.formattedDataSize(total));
+        return true;
     }
 
     // ALL commands that take a string argument
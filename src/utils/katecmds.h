@@ -57,7 +57,8 @@ class CoreCommands : public KTextEditor::Command
                                 QStringLiteral("set-highlight"),
                                 QStringLiteral("set-mode"),
                                 QStringLiteral("set-show-indent"),
-                                QStringLiteral("print")})
+                                QStringLiteral("print"),
+                                QStringLiteral("memstats")})
     {
     }
 
@@ -366,6 +366,8 @@ KateDocumentConfig::KateDocumentConfig()
     // .editorconfig
     addConfigEntry(ConfigEntry(UseEditorConfig, "Use Editor Config", QString(), true));
     addConfigEntry(ConfigEntry(UseFirstLineAsDocName, "Use First Line As Doc Name", QString(), true));
+    addConfigEntry(ConfigEntry(HighlightingCache, "Highlighting Cache", QStringLiteral("highlighting-cache"), false));
+    addConfigEntry(ConfigEntry(ProgressiveLoading, "Progressive Loading", QStringLiteral("progressive-loading"), false));
 
     // finalize the entries, e.g. hashes them
     finalizeConfigEntries();
@@ -553,6 +553,16 @@ public:
          * Should we use the first line of doc to infer the document name
          */
         UseFirstLineAsDocName,
+
+        /**
+         * Should we remember the highlighting of large files on disk
+         */
+        HighlightingCache,
+
+        /**
+         * Should we show large files while they are still loading
+         */
+        ProgressiveLoading,
     };
 
 public:
@@ -947,6 +957,16 @@ public:
         return value(AutoDetectIndent).toBool();
     }
 
+    bool highlightingCache() const
+    {
+        return value(HighlightingCache).toBool();
+    }
+
+    bool progressiveLoading() const
+    {
+        return value(ProgressiveLoading).toBool();
+    }
+
     bool autoSave() const
     {
         return value(AutoSave).toBool();
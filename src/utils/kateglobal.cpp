@@ -21,6 +21,7 @@
 #include "kateconfig.h"
 #include "katedialogs.h"
 #include "katedocument.h"
+#include "katehighlightingcache.h"
 #include "katehighlightingcmds.h"
 #include "katekeywordcompletion.h"
 #include "katemodelinecompletion.h"
@@ -52,6 +53,7 @@
 #include <QScrollBar>
 #include <QStringListModel>
 #include <QTextToSpeech>
+#include <QThreadPool>
 #include <QTimer>
 
 KTextEditor::EditorPrivate::EditorPrivate(QPointer<KTextEditor::EditorPrivate> &staticInstance)
@@ -138,6 +140,13 @@ KTextEditor::EditorPrivate::EditorPrivate(QPointer<KTextEditor::EditorPrivate> &
     //
     m_dirWatch = new KDirWatch();
 
+    //
+    // highlighting cache writer
+    // one file after the other, each write limits the size of the cache directory
+    //
+    m_highlightingCacheWritePool = new QThreadPool();
+    m_highlightingCacheWritePool->setMaxThreadCount(1);
+
     //
     // command manager
     //
@@ -205,6 +214,10 @@ KTextEditor::EditorPrivate::EditorPrivate(QPointer<KTextEditor::EditorPrivate> &
 
 KTextEditor::EditorPrivate::~EditorPrivate()
 {
+    // pending highlighting caches are written before we go away
+    KateHighlightingCache::waitForWritten();
+    delete m_highlightingCacheWritePool;
+
     delete m_globalConfig;
     delete m_documentConfig;
     delete m_viewConfig;
@@ -26,6 +26,7 @@
 #include <memory>
 
 class QStringListModel;
+class QThreadPool;
 class QTextToSpeech;
 
 class KateCmd;
@@ -216,6 +217,15 @@ public:
         return m_dirWatch;
     }
 
+    /**
+     * thread writing the highlighting caches, see KateHighlightingCache::write()
+     * @return write pool
+     */
+    QThreadPool *highlightingCacheWritePool()
+    {
+        return m_highlightingCacheWritePool;
+    }
+
     /**
      * The global configuration of katepart, e.g. katepartrc
      * @return global shared access to katepartrc config
@@ -473,6 +483,11 @@ private:
      */
     KDirWatch *m_dirWatch;
 
+    /**
+     * thread writing the highlighting caches
+     */
+    QThreadPool *m_highlightingCacheWritePool;
+
     /**
      * mode manager
      */
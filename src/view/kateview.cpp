@@ -2429,6 +2429,15 @@ KateRendererConfig *KTextEditor::ViewPrivate::rendererConfig()
     return m_renderer->config();
 }
 
+KTextEditor::ViewPrivate::MemoryUsage KTextEditor::ViewPrivate::memoryUsage() const
+{
+    MemoryUsage usage;
+    usage.folding = m_textFolding.memoryUsage();
+    usage.layoutCache = m_viewInternal->cache()->memoryUsage();
+    usage.miniMap = m_viewInternal->m_lineScroll->miniMapMemoryUsage();
+    return usage;
+}
+
 void KTextEditor::ViewPrivate::updateConfig()
 {
     if (m_startingUp) {
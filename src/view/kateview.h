@@ -834,6 +834,33 @@ public:
         return m_textFolding;
     }
 
+    /**
+     * Memory used by the view specific data, in bytes.
+     * Values are computed from container sizes, all folding ranges and cached layouts are walked.
+     */
+    struct MemoryUsage {
+        /**
+         * folding ranges, the cursors of them are accounted in the document
+         */
+        qint64 folding = 0;
+
+        /**
+         * cached line layouts, estimated
+         */
+        qint64 layoutCache = 0;
+
+        /**
+         * minimap pixmap
+         */
+        qint64 miniMap = 0;
+    };
+
+    /**
+     * Memory accounting for this view.
+     * @return memory used by this view
+     */
+    MemoryUsage memoryUsage() const;
+
 public:
     void slotTextInserted(KTextEditor::View *view, const KTextEditor::Cursor position, const QString &text);
 
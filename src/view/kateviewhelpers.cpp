@@ -631,12 +631,11 @@ void KateScrollBar::updatePixmap()
         // Iterate over all visible lines, drawing them.
         for (int virtualLine = 0; virtualLine < docLineCount; virtualLine += lineIncrement) {
             int realLineNumber = m_view->textFolding().visibleLineToLine(virtualLine);
-            const Kate::TextLine kateline = m_doc->plainKateTextLine(realLineNumber);
-            const QString lineText = kateline.text();
-
             if (!simpleMode) {
-                m_doc->buffer().ensureHighlighted(realLineNumber);
+                m_doc->buffer().ensureHighlightedForPainting(realLineNumber);
             }
+            const Kate::TextLine kateline = m_doc->plainKateTextLine(realLineNumber);
+            const QString lineText = kateline.text();
 
             // get normal highlighting stuff
             const auto &attributes = kateline.attributesList();
@@ -2213,7 +2212,9 @@ void KateIconBorder::paintBorder(uint firstY, uint lastY)
                         }
                     }
                     if (!m_view->config()->showFoldingOnHoverOnly() || m_mouseOver) {
-                        if (!startingRanges.isEmpty() || m_doc->buffer().isFoldingStartingOnLine(realLine).first) {
+                        // no folding markers for lines still highlighted in the background, that would highlight them here
+                        if (!startingRanges.isEmpty()
+                            || (!m_doc->buffer().isHighlightingPending(realLine) && m_doc->buffer().isFoldingStartingOnLine(realLine).first)) {
                             if (anyFolded) {
                                 paintTriangle(p, foldingColor, lnX, y, m_foldingAreaWidth, h, false);
                             } else {
@@ -133,6 +133,15 @@ public:
     {
         return m_miniMapAll;
     }
+
+    /**
+     * Memory used by the pixmap of the mini-map.
+     * @return bytes used
+     */
+    qint64 miniMapMemoryUsage() const
+    {
+        return qint64(m_pixmap.width()) * m_pixmap.height() * m_pixmap.depth() / 8;
+    }
     inline void setMiniMapAll(bool b)
     {
         m_miniMapAll = b;